@@ -0,0 +1,321 @@
+#ifndef ARROWWRITER_H
+#define ARROWWRITER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "AsyncWriter.h"
+
+// Just enough of a FlatBuffers builder for Arrow's metadata. Like the real one it
+// builds back to front, children before the tables that refer to them, so every
+// offset points forward. Objects are referred to by their distance from the end of
+// the buffer; the bytes are kept reversed and flipped once when finished.
+class FlatBuilder {
+private:
+    std::vector<uint8_t> bytes; // reversed
+    size_t maxAlign = 4;
+    uint32_t tableStart = 0;
+    std::vector<std::pair<int, uint32_t>> tableFields; // (field id, where it was written)
+
+    void prependBytes(const void* data, size_t n) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        for (size_t i = n; i-- > 0;) bytes.push_back(p[i]);
+    }
+    void align(size_t alignment, size_t extra = 0) {
+        maxAlign = std::max(maxAlign, alignment);
+        while ((bytes.size() + extra) % alignment != 0) bytes.push_back(0);
+    }
+    uint32_t size() const { return static_cast<uint32_t>(bytes.size()); }
+
+public:
+    template <typename T>
+    void prepend(T value) {
+        align(sizeof(T));
+        prependBytes(&value, sizeof(T));
+    }
+    void prependRef(uint32_t ref) {
+        align(4);
+        prepend<uint32_t>(size() + 4 - ref);
+    }
+
+    uint32_t string(const std::string& s) {
+        align(4, s.size() + 1);
+        bytes.push_back(0);
+        prependBytes(s.data(), s.size());
+        prepend<uint32_t>(static_cast<uint32_t>(s.size()));
+        return size();
+    }
+    // vector of fixed layout structs
+    template <typename T>
+    uint32_t structs(const std::vector<T>& items) {
+        align(std::max<size_t>(alignof(T), 4), items.size() * sizeof(T));
+        for (size_t i = items.size(); i-- > 0;) prependBytes(&items[i], sizeof(T));
+        prepend<uint32_t>(static_cast<uint32_t>(items.size()));
+        return size();
+    }
+    // vector of tables or strings
+    uint32_t refs(const std::vector<uint32_t>& items) {
+        align(4, items.size() * 4);
+        for (size_t i = items.size(); i-- > 0;) prependRef(items[i]);
+        prepend<uint32_t>(static_cast<uint32_t>(items.size()));
+        return size();
+    }
+
+    // tables do not nest: make the children first
+    void startTable() {
+        tableFields.clear();
+        tableStart = size();
+    }
+    template <typename T>
+    void add(int id, T value) {
+        prepend(value);
+        tableFields.push_back({id, size()});
+    }
+    void addRef(int id, uint32_t ref) {
+        prependRef(ref);
+        tableFields.push_back({id, size()});
+    }
+    uint32_t endTable() {
+        prepend<int32_t>(0); // offset to the vtable, filled in below
+        uint32_t table = size();
+        int numFields = 0;
+        for (const auto& field : tableFields) numFields = std::max(numFields, field.first + 1);
+        std::vector<uint16_t> slots(numFields, 0);
+        for (const auto& field : tableFields) slots[field.first] = static_cast<uint16_t>(table - field.second);
+        for (int i = numFields; i-- > 0;) prepend<uint16_t>(slots[i]);
+        prepend<uint16_t>(static_cast<uint16_t>(table - tableStart));
+        prepend<uint16_t>(static_cast<uint16_t>(4 + 2 * numFields));
+        int32_t toVtable = static_cast<int32_t>(size() - table); // the vtable sits just before the table
+        for (int b = 0; b < 4; b++) bytes[table - 1 - b] = static_cast<uint8_t>(toVtable >> (8 * b));
+        return table;
+    }
+
+    std::vector<uint8_t> finish(uint32_t root) {
+        align(maxAlign, 4);
+        prependRef(root);
+        return std::vector<uint8_t>(bytes.rbegin(), bytes.rend());
+    }
+};
+
+// Writes a table in the Arrow IPC file format with no Arrow library: the schema, a
+// record batch every batchRows rows, and the footer that indexes them. Columns are
+// fixed width and never null. Every buffer starts on a 64 byte boundary of the file,
+// so a reader can map the file and use the columns where they lie. Values are
+// written in host byte order, which has to be little endian. The disk writes happen
+// on the file's own thread.
+class ArrowFileWriter {
+public:
+    enum class Type { Int32, Int64, Float64 };
+    struct Field {
+        std::string name;
+        Type type;
+    };
+
+private:
+    static constexpr size_t ALIGNMENT = 64;
+    static constexpr int16_t METADATA_V5 = 4;
+    enum HeaderType : uint8_t { SCHEMA = 1, RECORD_BATCH = 3 };
+    enum TypeId : uint8_t { INT = 2, FLOATING_POINT = 3 };
+
+    // the layouts Arrow's schema gives these structs
+    struct FieldNode {
+        int64_t length;
+        int64_t nullCount;
+    };
+    struct BufferSpec {
+        int64_t offset;
+        int64_t length;
+    };
+    struct Block {
+        int64_t offset;
+        int32_t metaDataLength;
+        int32_t padding;
+        int64_t bodyLength;
+    };
+
+    std::string path;
+    AsyncOfstream file;
+    std::vector<Field> fields;
+    std::vector<std::vector<uint8_t>> columns; // the batch being filled
+    size_t batchRows;
+    size_t rows = 0;
+    size_t nextColumn = 0;
+    uint64_t written = 0;
+    std::vector<Block> blocks;
+
+    static size_t width(Type type) { return type == Type::Int32 ? 4 : 8; }
+    static size_t padded(size_t n) { return (n + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+    void writeBytes(const void* data, size_t n) {
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(n));
+        written += n;
+    }
+    void writeZeros(size_t n) {
+        static const char zeros[ALIGNMENT] = {};
+        while (n > 0) {
+            size_t chunk = std::min(n, ALIGNMENT);
+            writeBytes(zeros, chunk);
+            n -= chunk;
+        }
+    }
+
+    uint32_t buildSchema(FlatBuilder& b) const {
+        std::vector<uint32_t> fieldRefs;
+        for (const Field& field : fields) {
+            uint32_t name = b.string(field.name);
+            b.startTable();
+            if (field.type == Type::Float64) {
+                b.add<int16_t>(0, 2); // precision DOUBLE
+            } else {
+                b.add<int32_t>(0, static_cast<int32_t>(8 * width(field.type))); // bitWidth
+                b.add<uint8_t>(1, 1); // is_signed
+            }
+            uint32_t type = b.endTable();
+            uint32_t children = b.refs({});
+            b.startTable();
+            b.addRef(0, name);
+            b.add<uint8_t>(1, 0); // nullable
+            b.add<uint8_t>(2, field.type == Type::Float64 ? FLOATING_POINT : INT);
+            b.addRef(3, type);
+            b.addRef(5, children);
+            fieldRefs.push_back(b.endTable());
+        }
+        uint32_t fieldVector = b.refs(fieldRefs);
+        b.startTable();
+        b.add<int16_t>(0, 0); // little endian
+        b.addRef(1, fieldVector);
+        return b.endTable();
+    }
+
+    // one encapsulated message: continuation marker, metadata length, metadata, body;
+    // the metadata is padded so the body starts on the alignment
+    Block writeMessage(FlatBuilder& b, HeaderType headerType, uint32_t header, int64_t bodyLength) {
+        b.startTable();
+        b.add<int16_t>(0, METADATA_V5);
+        b.add<uint8_t>(1, headerType);
+        b.addRef(2, header);
+        b.add<int64_t>(3, bodyLength);
+        std::vector<uint8_t> metadata = b.finish(b.endTable());
+        Block block = {static_cast<int64_t>(written), 0, 0, bodyLength};
+        size_t metaLength = padded(written + 8 + metadata.size()) - written - 8;
+        int32_t prefix[2] = {-1, static_cast<int32_t>(metaLength)};
+        writeBytes(prefix, sizeof(prefix));
+        writeBytes(metadata.data(), metadata.size());
+        writeZeros(metaLength - metadata.size());
+        block.metaDataLength = static_cast<int32_t>(8 + metaLength);
+        return block;
+    }
+
+    void writeBatch() {
+        std::vector<FieldNode> nodes;
+        std::vector<BufferSpec> buffers;
+        int64_t bodyLength = 0;
+        for (size_t c = 0; c < fields.size(); c++) {
+            nodes.push_back({static_cast<int64_t>(rows), 0});
+            buffers.push_back({bodyLength, 0}); // no validity bitmap, nothing is null
+            buffers.push_back({bodyLength, static_cast<int64_t>(columns[c].size())});
+            bodyLength += static_cast<int64_t>(padded(columns[c].size()));
+        }
+        FlatBuilder b;
+        uint32_t nodeVector = b.structs(nodes);
+        uint32_t bufferVector = b.structs(buffers);
+        b.startTable();
+        b.add<int64_t>(0, static_cast<int64_t>(rows));
+        b.addRef(1, nodeVector);
+        b.addRef(2, bufferVector);
+        uint32_t batch = b.endTable();
+        blocks.push_back(writeMessage(b, RECORD_BATCH, batch, bodyLength));
+        for (std::vector<uint8_t>& column : columns) {
+            writeBytes(column.data(), column.size());
+            writeZeros(padded(column.size()) - column.size());
+            column.clear();
+        }
+        rows = 0;
+        if (!file) {
+            throw std::runtime_error("Failed to write Arrow file: " + path);
+        }
+    }
+
+    template <typename T>
+    void putValue(Type type, T value) {
+        if (nextColumn >= fields.size() || fields[nextColumn].type != type) {
+            throw std::runtime_error("Wrong type for column " + std::to_string(nextColumn) + " of " + path);
+        }
+        std::vector<uint8_t>& column = columns[nextColumn];
+        size_t at = column.size();
+        column.resize(at + sizeof(T));
+        std::memcpy(column.data() + at, &value, sizeof(T));
+        if (++nextColumn == fields.size()) {
+            nextColumn = 0;
+            if (++rows == batchRows) writeBatch();
+        }
+    }
+
+public:
+    ArrowFileWriter(const std::string& pPath, const std::vector<Field>& pFields, size_t pBatchRows = 65536)
+        : path(pPath), fields(pFields), columns(pFields.size()), batchRows(std::max<size_t>(1, pBatchRows)) {
+        file.open(path);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open Arrow file: " + path);
+        }
+        for (size_t c = 0; c < fields.size(); c++) {
+            columns[c].reserve(batchRows * width(fields[c].type));
+        }
+        writeBytes("ARROW1\0\0", 8);
+        FlatBuilder b;
+        uint32_t schema = buildSchema(b);
+        writeMessage(b, SCHEMA, schema, 0);
+    }
+    ~ArrowFileWriter() {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+    ArrowFileWriter(const ArrowFileWriter&) = delete;
+    ArrowFileWriter& operator=(const ArrowFileWriter&) = delete;
+
+    // a row is one put per column, in column order
+    void put(int value) { putValue(Type::Int32, static_cast<int32_t>(value)); }
+    void put(long long value) { putValue(Type::Int64, static_cast<int64_t>(value)); }
+    void put(double value) { putValue(Type::Float64, value); }
+
+    // the batch being filled, the block list and the file's buffers
+    size_t bytes() const {
+        size_t total = file.bytes() + blocks.capacity() * sizeof(Block);
+        for (const std::vector<uint8_t>& column : columns) total += column.capacity();
+        return total;
+    }
+
+    // writes the last batch and the footer; the file is only readable after this
+    void close() {
+        if (!file.is_open()) return;
+        if (rows > 0) writeBatch();
+        int32_t endOfStream[2] = {-1, 0};
+        writeBytes(endOfStream, sizeof(endOfStream));
+        FlatBuilder b;
+        uint32_t schema = buildSchema(b);
+        uint32_t dictionaries = b.structs(std::vector<Block>());
+        uint32_t batches = b.structs(blocks);
+        b.startTable();
+        b.add<int16_t>(0, METADATA_V5);
+        b.addRef(1, schema);
+        b.addRef(2, dictionaries);
+        b.addRef(3, batches);
+        std::vector<uint8_t> footer = b.finish(b.endTable());
+        writeBytes(footer.data(), footer.size());
+        int32_t footerLength = static_cast<int32_t>(footer.size());
+        writeBytes(&footerLength, sizeof(footerLength));
+        writeBytes("ARROW1", 6);
+        file.close();
+        if (file.fail()) {
+            throw std::runtime_error("Failed to write Arrow file: " + path);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Stream buffer that leaves the disk to a thread of its own. Writes fill the current
+// buffer; a full one (or a flush) is queued for the writer thread and the next free
+// buffer taken, so the caller only waits when every buffer is still queued, that is
+// when the disk has fallen behind by the whole ring. Two buffers is double buffering.
+class AsyncFileBuf : public std::streambuf {
+private:
+    std::FILE* file = nullptr;
+    size_t bufferBytes;
+    std::vector<std::vector<char>> buffers;
+    std::vector<size_t> lengths;
+    std::deque<size_t> full;  // queued for the disk, oldest first
+    std::vector<size_t> spare; // ready to be filled
+    size_t current = 0;
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool stopping = false;
+    bool failed = false;
+    std::thread writer;
+
+    void writerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            changed.wait(lock, [this] { return stopping || !full.empty(); });
+            if (full.empty()) return; // stopping, and everything is written
+            size_t b = full.front();
+            full.pop_front();
+            lock.unlock();
+            bool written = std::fwrite(buffers[b].data(), 1, lengths[b], file) == lengths[b];
+            lock.lock();
+            if (!written) failed = true;
+            spare.push_back(b);
+            changed.notify_all();
+        }
+    }
+    // queues what is in the current buffer and moves on to a free one
+    bool handOff() {
+        size_t n = static_cast<size_t>(pptr() - pbase());
+        std::unique_lock<std::mutex> lock(mutex);
+        if (n > 0) {
+            lengths[current] = n;
+            full.push_back(current);
+            changed.notify_all();
+            changed.wait(lock, [this] { return !spare.empty(); });
+            current = spare.back();
+            spare.pop_back();
+        }
+        setp(buffers[current].data(), buffers[current].data() + bufferBytes);
+        return !failed;
+    }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (!file || !handOff()) return traits_type::eof();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        if (!file) return 0;
+        std::streamsize done = 0;
+        while (done < n) {
+            if (pptr() == epptr() && !handOff()) break;
+            std::streamsize chunk = std::min<std::streamsize>(n - done, epptr() - pptr());
+            std::memcpy(pptr(), s + done, static_cast<size_t>(chunk));
+            pbump(static_cast<int>(chunk));
+            done += chunk;
+        }
+        return done;
+    }
+    int sync() override { return file && handOff() ? 0 : -1; }
+
+public:
+    explicit AsyncFileBuf(size_t pBufferBytes = 1 << 20, size_t numBuffers = 2)
+        : bufferBytes(std::max<size_t>(1, pBufferBytes)), buffers(std::max<size_t>(2, numBuffers)), lengths(buffers.size(), 0) {}
+    ~AsyncFileBuf() override { close(); }
+    AsyncFileBuf(const AsyncFileBuf&) = delete;
+    AsyncFileBuf& operator=(const AsyncFileBuf&) = delete;
+
+    bool open(const std::string& path, bool append) {
+        if (file) return false;
+        file = std::fopen(path.c_str(), append ? "ab" : "wb");
+        if (!file) return false;
+        std::setvbuf(file, nullptr, _IONBF, 0); // the ring is the buffer
+        for (std::vector<char>& buffer : buffers) buffer.resize(bufferBytes);
+        spare.clear();
+        for (size_t b = 1; b < buffers.size(); b++) spare.push_back(b);
+        current = 0;
+        stopping = false;
+        failed = false;
+        setp(buffers[current].data(), buffers[current].data() + bufferBytes);
+        writer = std::thread(&AsyncFileBuf::writerLoop, this);
+        return true;
+    }
+    bool isOpen() const { return file != nullptr; }
+    // the ring, while the file is open
+    size_t bytes() const {
+        size_t total = 0;
+        for (const std::vector<char>& buffer : buffers) total += buffer.capacity();
+        return total;
+    }
+
+    // writes out everything queued; false if any of it failed
+    bool close() {
+        if (!file) return true;
+        handOff();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        writer.join();
+        bool closed = std::fclose(file) == 0;
+        file = nullptr;
+        setp(nullptr, nullptr);
+        for (std::vector<char>& buffer : buffers) std::vector<char>().swap(buffer);
+        return closed && !failed;
+    }
+};
+
+// std::ofstream's interface over an AsyncFileBuf
+class AsyncOfstream : public std::ostream {
+private:
+    AsyncFileBuf buf;
+
+public:
+    explicit AsyncOfstream(size_t bufferBytes = 1 << 20, size_t numBuffers = 2)
+        : std::ostream(nullptr), buf(bufferBytes, numBuffers) {
+        rdbuf(&buf);
+    }
+
+    void open(const std::string& path, bool append = false) {
+        if (buf.open(path, append)) {
+            clear();
+        } else {
+            setstate(std::ios::failbit);
+        }
+    }
+    bool is_open() const { return buf.isOpen(); }
+    size_t bytes() const { return buf.bytes(); }
+    void close() {
+        if (!buf.close()) setstate(std::ios::failbit);
+    }
+};
+
+#endif
@@ -10,6 +10,7 @@ private:
 
 public:
     explicit SimulationObject(const std::string& _name) : name(_name) {}
+    virtual ~SimulationObject() = default;
     virtual void update() = 0; // Pure virtual
     virtual void collide() = 0; // Pure virtual
 };
@@ -23,6 +24,7 @@ private:
 
 public:
     Configure(Simulation* simulation = nullptr);
+    virtual ~Configure() = default;
     virtual void configure() = 0; // Pure virtual
     void setSimulation(Simulation* sim) { simulation = sim; }
 };
@@ -31,6 +33,7 @@ class Clock {
 public:
     Clock(int initialTimesteps, int timestepsLimit)
         : timesteps(initialTimesteps), timestepsLimit(timestepsLimit), simulationRunning(true) {}
+    virtual ~Clock() = default;
     int getTimesteps() const { return timesteps; }
     int getTimestepsLimit() const { return timestepsLimit; }
     virtual void update() {
@@ -57,6 +60,7 @@ private:
 
 public:
     Simulation();
+    ~Simulation(); // the simulation owns every object added to it
     void run() {
         config->configure();
         while (clockPTR->checkStop()){
@@ -82,6 +86,7 @@ public:
     std::vector<SimulationObject*> getObjects(){
         return simulationObjects;
     }
+    size_t getObjectCapacity() const { return simulationObjects.capacity(); }
 };
 
 // Inline definitions to resolve linker issues
@@ -92,6 +97,12 @@ inline Simulation::Simulation()
     : config(nullptr), clockPTR(nullptr) {}
 
 
+inline Simulation::~Simulation() {
+    for (SimulationObject* obj : simulationObjects) {
+        delete obj;
+    }
+}
+
 inline void Simulation::setConfig(Configure* cfg) {
     config = cfg;
     if (config) config->setSimulation(this);
@@ -0,0 +1,106 @@
+#ifndef DENSITYHEATMAP_H
+#define DENSITYHEATMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Snail-ticks per cell of a grid laid over the swamp, cellSize swamp cells on a side,
+// summed over a window of ticks. A tick is two passes over the positions: a
+// branch-free pass that turns them into cell numbers and vectorizes, then the
+// scatter-add into the grid. Memory is the grid plus that scratch, however many
+// snails and ticks go in. A window closes every windowTicks ticks, or never with 0.
+class DensityHeatmap {
+private:
+    int minX;
+    int minY;
+    int cellSize;
+    int columns;
+    int rows;
+    int windowTicks;
+    double inverseCell;
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> cells; // scratch, the cell of each position
+    int firstTick = 0;           // of the window being filled
+    int lastTick = 0;
+    int ticks = 0;               // in the window being filled
+    int closedFirst = 0;
+    int closedLast = 0;
+
+    // (value - origin) / cellSize without a division, which would stop the pass from
+    // vectorizing: the product is off by at most one either way, so it is corrected
+    uint32_t cellAlong(int value, int origin, int limit) const {
+        int offset = std::min(std::max(value - origin, 0), limit);
+        int q = static_cast<int>(offset * inverseCell);
+        q += (q + 1) * cellSize <= offset;
+        q -= q * cellSize > offset;
+        return static_cast<uint32_t>(q);
+    }
+
+    void close() {
+        closedFirst = firstTick;
+        closedLast = lastTick;
+        ticks = 0; // the counts stay readable until the next tick comes in
+    }
+
+public:
+    // the grid covers the inclusive rectangle of swamp cells
+    DensityHeatmap(int pMinX, int pMinY, int maxX, int maxY, int pCellSize, int pWindowTicks = 0)
+        : minX(pMinX), minY(pMinY), cellSize(pCellSize), windowTicks(pWindowTicks) {
+        if (cellSize <= 0 || windowTicks < 0 || maxX < minX || maxY < minY) {
+            throw std::runtime_error("Heatmap needs a positive cell size and a non-empty swamp");
+        }
+        columns = (maxX - minX) / cellSize + 1;
+        rows = (maxY - minY) / cellSize + 1;
+        inverseCell = 1.0 / cellSize;
+        counts.assign(static_cast<size_t>(columns) * rows, 0);
+    }
+
+    // one tick's positions; weight, if given, is 0 for rows to leave out (the dead)
+    // and 1 otherwise. True when a window closed with this tick.
+    bool addTick(int tick, const int* xs, const int* ys, const uint8_t* weight, size_t n) {
+        if (ticks == 0) {
+            std::fill(counts.begin(), counts.end(), 0);
+            firstTick = tick;
+        }
+        lastTick = tick;
+        ticks++;
+        cells.resize(n);
+        int limitX = columns * cellSize - 1;
+        int limitY = rows * cellSize - 1;
+        for (size_t i = 0; i < n; i++) {
+            cells[i] = cellAlong(ys[i], minY, limitY) * static_cast<uint32_t>(columns) + cellAlong(xs[i], minX, limitX);
+        }
+        if (weight) {
+            for (size_t i = 0; i < n; i++) counts[cells[i]] += weight[i];
+        } else {
+            for (size_t i = 0; i < n; i++) counts[cells[i]]++;
+        }
+        if (windowTicks == 0 || ticks < windowTicks) return false;
+        close();
+        return true;
+    }
+    // closes a shorter window over the ticks since the last one; false if there were none
+    bool flush() {
+        if (ticks == 0) return false;
+        close();
+        return true;
+    }
+
+    // the window that closed last
+    int windowFirstTick() const { return closedFirst; }
+    int windowLastTick() const { return closedLast; }
+    int getMinX() const { return minX; }
+    int getMinY() const { return minY; }
+    int getCellSize() const { return cellSize; }
+    int getColumns() const { return columns; }
+    int getRows() const { return rows; }
+    // row major, row 0 at minY
+    const std::vector<uint32_t>& getCounts() const { return counts; }
+
+    size_t bytes() const { return (counts.capacity() + cells.capacity()) * sizeof(uint32_t); }
+};
+
+#endif
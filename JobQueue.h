@@ -0,0 +1,237 @@
+#ifndef JOBQUEUE_H
+#define JOBQUEUE_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+// Work queue kept in a shared directory, for workers on machines that only share a
+// filesystem. Each job is a file that moves between directories by rename, which is
+// atomic, so a job is in exactly one place and only one worker wins a claim:
+//   pending/job-N              waiting
+//   leased/job-N.<worker>      being worked on; the mtime is the lease, renewed by touching
+//   done/job-N                 finished
+// A lease that has not been renewed for the timeout is moved back to pending. Lease ages
+// are measured against the mtime of a file the worker just touched, so they use the file
+// server's clock and the machines' clocks need not agree.
+class JobQueue {
+public:
+    struct Job {
+        size_t index;
+        std::string payload;
+        std::filesystem::path lease;
+    };
+
+private:
+    std::filesystem::path root;
+    std::string worker;
+    double leaseSeconds;
+
+    std::filesystem::path dir(const char* name) const { return root / name; }
+    static std::string jobName(size_t index) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "job-%08zu", index);
+        return name;
+    }
+    // index of a job file, whatever state suffix it has; the digits run up to the
+    // suffix's '.', as past 10^8 jobs they are more than the 8 jobName pads to
+    static bool parseIndex(const std::string& name, size_t& index) {
+        if (name.compare(0, 4, "job-") != 0) return false;
+        index = std::stoul(name.substr(4, name.find('.') - 4));
+        return true;
+    }
+    static bool touch(const std::filesystem::path& path) {
+        return utime(path.c_str(), nullptr) == 0; // the server's idea of now
+    }
+    static double mtime(const std::filesystem::path& path) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) return -1;
+        return info.st_mtim.tv_sec + info.st_mtim.tv_nsec * 1e-9;
+    }
+    double filesystemNow() const {
+        std::filesystem::path clock = dir("clocks") / worker;
+        if (!touch(clock)) {
+            std::ofstream(clock).close();
+        }
+        return mtime(clock);
+    }
+    static bool moveFile(const std::filesystem::path& from, const std::filesystem::path& to) {
+        std::error_code error;
+        std::filesystem::rename(from, to, error);
+        return !error;
+    }
+    std::vector<std::string> list(const char* name) const {
+        std::vector<std::string> names;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(dir(name), error)) {
+            names.push_back(entry.path().filename().string());
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+    // stale leases go back to pending; two workers may race, the rename decides
+    void reclaimStale() {
+        double now = filesystemNow();
+        for (const std::string& name : list("leased")) {
+            double leasedAt = mtime(dir("leased") / name);
+            if (leasedAt < 0 || now - leasedAt < leaseSeconds) continue;
+            moveFile(dir("leased") / name, dir("pending") / name.substr(0, name.find('.')));
+        }
+    }
+
+public:
+    JobQueue(const std::filesystem::path& pRoot, const std::string& pWorker, double pLeaseSeconds)
+        : root(pRoot), worker(pWorker), leaseSeconds(pLeaseSeconds) {}
+
+    // Sets the queue up with one job per payload plus a manifest describing the work,
+    // unless someone else already has; returns false if the queue was already there.
+    // Only the worker that makes create.lock sets it up, and the jobs appear all at once
+    // by renaming the directory they were written to.
+    bool create(const std::vector<std::string>& payloads, const std::string& manifest) {
+        std::filesystem::create_directories(root);
+        std::error_code error;
+        if (!std::filesystem::create_directory(root / "create.lock", error)) return false;
+        for (const char* name : {"leased", "done", "shards", "clocks"}) {
+            std::filesystem::create_directories(dir(name));
+        }
+        std::ofstream(root / "manifest") << manifest;
+        std::filesystem::path staging = root / ("staging." + worker);
+        std::filesystem::create_directories(staging);
+        for (size_t i = 0; i < payloads.size(); i++) {
+            std::ofstream(staging / jobName(i)) << payloads[i];
+        }
+        if (!moveFile(staging, dir("pending"))) {
+            throw std::runtime_error("Could not publish the jobs in " + root.string());
+        }
+        return true;
+    }
+    // waits for a queue someone else is creating
+    std::string readManifest(double timeoutSeconds = 60) const {
+        auto start = std::chrono::steady_clock::now();
+        while (!std::filesystem::exists(dir("pending")) || !std::filesystem::exists(root / "manifest")) {
+            if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > timeoutSeconds) {
+                throw std::runtime_error("Job queue never appeared in " + root.string());
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        std::ifstream file(root / "manifest");
+        std::stringstream text;
+        text << file.rdbuf();
+        return text.str();
+    }
+
+    // takes the lowest pending job, reclaiming stale leases once the pending ones run out
+    bool claim(Job& job) {
+        for (int attempt = 0; attempt < 2; attempt++) {
+            for (const std::string& name : list("pending")) {
+                std::filesystem::path from = dir("pending") / name;
+                std::filesystem::path to = dir("leased") / (name + "." + worker);
+                touch(from); // so the lease starts fresh the moment it is taken
+                if (!moveFile(from, to)) continue; // someone else was quicker
+                touch(to);
+                std::ifstream file(to);
+                std::stringstream payload;
+                payload << file.rdbuf();
+                parseIndex(name, job.index);
+                job.payload = payload.str();
+                job.lease = to;
+                return true;
+            }
+            reclaimStale();
+        }
+        return false;
+    }
+    // keeps a lease alive; false if it was taken away as stale
+    bool renew(const Job& job) const { return touch(job.lease); }
+    void complete(const Job& job) {
+        moveFile(job.lease, dir("done") / jobName(job.index)); // fails harmlessly if it was reclaimed
+    }
+
+    size_t pendingCount() const { return list("pending").size(); }
+    size_t leasedCount() const { return list("leased").size(); }
+    bool finished() const { return pendingCount() == 0 && leasedCount() == 0; }
+
+    // where this worker appends its results
+    std::filesystem::path shardPath() const { return dir("shards") / (worker + ".csv"); }
+    // Appends to this worker's shard and closes it again after an fsync, so the bytes
+    // are on the file server before the job is completed; the merger only reads the
+    // shards once every job is done and must not find one short.
+    void appendResult(const std::string& text) const {
+        std::filesystem::path path = shardPath();
+        int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open shard: " + path.string());
+        }
+        size_t written = 0;
+        while (written < text.size()) {
+            ssize_t n = write(fd, text.data() + written, text.size() - written);
+            if (n < 0) {
+                close(fd);
+                throw std::runtime_error("Failed to write shard: " + path.string());
+            }
+            written += static_cast<size_t>(n);
+        }
+        bool synced = fsync(fd) == 0;
+        if (close(fd) != 0 || !synced) {
+            throw std::runtime_error("Failed to sync shard: " + path.string());
+        }
+    }
+    std::vector<std::filesystem::path> shards() const {
+        std::vector<std::filesystem::path> paths;
+        for (const std::string& name : list("shards")) {
+            paths.push_back(dir("shards") / name);
+        }
+        return paths;
+    }
+    // only one worker gets to merge
+    bool lockMerge() const {
+        std::error_code error;
+        return std::filesystem::create_directory(root / "merge.lock", error);
+    }
+    const std::filesystem::path& getRoot() const { return root; }
+};
+
+// Renews a lease from a background thread for as long as it lives, so a job may
+// take longer than the lease timeout without being reclaimed
+class LeaseKeeper {
+private:
+    std::mutex mutex;
+    std::condition_variable stop;
+    bool stopping = false;
+    std::thread thread;
+
+public:
+    LeaseKeeper(const JobQueue& queue, const JobQueue::Job& job, double intervalSeconds)
+        : thread([this, &queue, job, intervalSeconds] {
+              std::unique_lock<std::mutex> lock(mutex);
+              while (!stop.wait_for(lock, std::chrono::duration<double>(intervalSeconds), [this] { return stopping; })) {
+                  queue.renew(job);
+              }
+          }) {}
+    ~LeaseKeeper() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        stop.notify_one();
+        thread.join();
+    }
+    LeaseKeeper(const LeaseKeeper&) = delete;
+    LeaseKeeper& operator=(const LeaseKeeper&) = delete;
+};
+
+#endif
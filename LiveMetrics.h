@@ -0,0 +1,251 @@
+#ifndef LIVEMETRICS_H
+#define LIVEMETRICS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <poll.h>     // for poll
+#include <sys/socket.h>
+#include <sys/un.h>   // for sockaddr_un
+#include <unistd.h>   // for close, unlink
+#include "MemoryAccounting.h"
+
+// Counters of a running sweep. The simulation only does relaxed atomic adds and
+// stores, a few per tick, so keeping them costs nothing measurable whether or not
+// anyone reads them; readers get a recent value of each, not a consistent set.
+class LiveMetrics {
+public:
+    // where a run's time goes, for any engine
+    enum Phase { Setup, Simulate, Record, Write, NUM_PHASES };
+    // where a population engine tick's time goes
+    enum StepPhase { Lifecycle, Occupancy, Predation, Movement, Feeding, Breeding, Output, NUM_STEP_PHASES };
+
+    std::atomic<long long> cellsTotal{0};   // 0 where the process cannot see the sweep's progress
+    std::atomic<long long> cellsDone{0};    // finished, as far as this process knows
+    std::atomic<long long> cellsRun{0};     // simulated by this process
+    std::atomic<long long> replicates{0};
+    std::atomic<long long> ticks{0};
+    std::atomic<long long> snailTicks{0};
+    std::atomic<long long> population{0};   // at the last tick of the run going on
+    std::atomic<long long> phaseNanos[NUM_PHASES] = {};
+    std::atomic<long long> stepNanos[NUM_STEP_PHASES] = {};
+
+    static const char* phaseName(int phase) {
+        static const char* names[] = {"setup", "simulate", "record", "write"};
+        return names[phase];
+    }
+    static const char* stepPhaseName(int phase) {
+        static const char* names[] = {"lifecycle", "occupancy", "predation", "movement", "feeding", "breeding", "output"};
+        return names[phase];
+    }
+
+    void addTick(long long pPopulation) {
+        ticks.fetch_add(1, std::memory_order_relaxed);
+        snailTicks.fetch_add(pPopulation, std::memory_order_relaxed);
+        population.store(pPopulation, std::memory_order_relaxed);
+    }
+    void addPhase(Phase phase, std::chrono::steady_clock::duration elapsed) {
+        phaseNanos[phase].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+    }
+    void addStepPhase(StepPhase phase, std::chrono::steady_clock::duration elapsed) {
+        stepNanos[phase].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+    }
+
+    // Prometheus text format, every sample labelled with the worker; rate is the
+    // snail-ticks per second since the last rendering
+    std::string render(const std::string& worker, double rate) const {
+        std::ostringstream out;
+        std::string label = "worker=\"" + worker + "\"";
+        auto metric = [&](const char* name, const char* type, const char* help) {
+            out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+        };
+        auto load = [](const std::atomic<long long>& value) { return value.load(std::memory_order_relaxed); };
+        long long total = load(cellsTotal);
+        if (total > 0) {
+            metric("snail_cells", "gauge", "Cells in the sweep.");
+            out << "snail_cells{" << label << "} " << total << "\n";
+            metric("snail_cells_done", "gauge", "Cells of the sweep finished.");
+            out << "snail_cells_done{" << label << "} " << load(cellsDone) << "\n";
+            metric("snail_cells_remaining", "gauge", "Cells of the sweep not finished yet.");
+            out << "snail_cells_remaining{" << label << "} " << total - load(cellsDone) << "\n";
+        }
+        metric("snail_cells_run_total", "counter", "Cells simulated by this worker.");
+        out << "snail_cells_run_total{" << label << "} " << load(cellsRun) << "\n";
+        metric("snail_replicates_total", "counter", "Runs simulated by this worker.");
+        out << "snail_replicates_total{" << label << "} " << load(replicates) << "\n";
+        metric("snail_ticks_total", "counter", "Ticks simulated.");
+        out << "snail_ticks_total{" << label << "} " << load(ticks) << "\n";
+        metric("snail_snail_ticks_total", "counter", "Snails alive summed over the ticks simulated.");
+        out << "snail_snail_ticks_total{" << label << "} " << load(snailTicks) << "\n";
+        metric("snail_snail_ticks_per_second", "gauge", "Snail-ticks per second since the last update.");
+        out << "snail_snail_ticks_per_second{" << label << "} " << rate << "\n";
+        metric("snail_population", "gauge", "Snails alive at the last tick of the current run.");
+        out << "snail_population{" << label << "} " << load(population) << "\n";
+        metric("snail_phase_seconds_total", "counter", "Time spent in each phase of a run.");
+        for (int p = 0; p < NUM_PHASES; p++) {
+            out << "snail_phase_seconds_total{" << label << ",phase=\"" << phaseName(p) << "\"} " << load(phaseNanos[p]) * 1e-9 << "\n";
+        }
+        metric("snail_step_phase_seconds_total", "counter", "Time spent in each phase of a population engine tick.");
+        for (int p = 0; p < NUM_STEP_PHASES; p++) {
+            out << "snail_step_phase_seconds_total{" << label << ",phase=\"" << stepPhaseName(p) << "\"} " << load(stepNanos[p]) * 1e-9 << "\n";
+        }
+        metric("snail_resident_memory_bytes", "gauge", "Resident set size of the worker.");
+        out << "snail_resident_memory_bytes{" << label << "} " << currentRss() << "\n";
+        metric("snail_peak_resident_memory_bytes", "gauge", "Peak resident set size of the worker.");
+        out << "snail_peak_resident_memory_bytes{" << label << "} " << peakRss() << "\n";
+        return out.str();
+    }
+};
+
+// Times the phases of a run one after another into the metrics: each switch ends the
+// phase before, and so does going out of scope
+class PhaseTimer {
+private:
+    LiveMetrics& metrics;
+    LiveMetrics::Phase phase;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    PhaseTimer(LiveMetrics& pMetrics, LiveMetrics::Phase pPhase)
+        : metrics(pMetrics), phase(pPhase), start(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() { metrics.addPhase(phase, std::chrono::steady_clock::now() - start); }
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    void switchTo(LiveMetrics::Phase next) {
+        auto now = std::chrono::steady_clock::now();
+        metrics.addPhase(phase, now - start);
+        phase = next;
+        start = now;
+    }
+};
+
+// Publishes the metrics from a thread of its own every interval seconds, either by
+// rewriting a file or to whoever connects to a Unix socket. The file is written
+// beside its final name and renamed over it, so a scraper such as node exporter's
+// textfile collector never sees half of it. The socket answers every connection
+// with a minimal HTTP response carrying the text, so curl --unix-socket or a proxy
+// can scrape it; it is served from the same thread, between updates of the rate.
+class MetricsPublisher {
+private:
+    const LiveMetrics& metrics;
+    std::string path;
+    bool socketMode;
+    std::string worker;
+    double interval;
+    int listenFd = -1;
+    std::mutex mutex;
+    std::condition_variable stopped;
+    bool stopping = false;
+    long long lastSnailTicks = 0;
+    std::chrono::steady_clock::time_point lastTime = std::chrono::steady_clock::now();
+    double rate = 0.0;
+    std::thread thread;
+
+    void updateRate() {
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - lastTime).count();
+        long long snailTicks = metrics.snailTicks.load(std::memory_order_relaxed);
+        if (seconds > 0.0) rate = (snailTicks - lastSnailTicks) / seconds;
+        lastSnailTicks = snailTicks;
+        lastTime = now;
+    }
+    void writeFile() const {
+        std::string text = metrics.render(worker, rate);
+        std::string temporary = path + ".tmp";
+        std::FILE* file = std::fopen(temporary.c_str(), "w");
+        if (!file) return; // a scraper will notice the file going stale
+        bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+        if (std::fclose(file) == 0 && written) std::rename(temporary.c_str(), path.c_str());
+    }
+    void serve(int fd) const {
+        char request[1024];
+        pollfd waiting = {fd, POLLIN, 0};
+        if (poll(&waiting, 1, 1000) > 0) { // the request itself does not matter
+            ssize_t ignored = recv(fd, request, sizeof(request), 0);
+            (void)ignored;
+        }
+        std::string body = metrics.render(worker, rate);
+        std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                               std::to_string(body.size()) + "\r\n\r\n" + body;
+        for (size_t sent = 0; sent < response.size();) {
+            ssize_t n = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += static_cast<size_t>(n);
+        }
+        ::close(fd);
+    }
+
+    void loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto next = std::chrono::steady_clock::now();
+        while (!stopping) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= next) {
+                updateRate();
+                if (!socketMode) writeFile();
+                next = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(interval));
+            }
+            if (!socketMode) {
+                stopped.wait_until(lock, next, [this] { return stopping; });
+                continue;
+            }
+            // wait for a scraper, waking now and then to see whether it is time to stop
+            lock.unlock();
+            pollfd listening = {listenFd, POLLIN, 0};
+            int waitMs = static_cast<int>(std::min(200.0, std::chrono::duration<double, std::milli>(next - now).count()));
+            if (poll(&listening, 1, std::max(waitMs, 1)) > 0) {
+                int fd = accept(listenFd, nullptr, nullptr);
+                if (fd >= 0) serve(fd);
+            }
+            lock.lock();
+        }
+        updateRate();
+        if (!socketMode) writeFile(); // the final figures stay for the scraper
+    }
+
+public:
+    // path is a file, or a socket with useSocket set
+    MetricsPublisher(const LiveMetrics& pMetrics, const std::string& pPath, bool useSocket, const std::string& pWorker, double pInterval)
+        : metrics(pMetrics), path(pPath), socketMode(useSocket), worker(pWorker), interval(pInterval) {
+        if (socketMode) {
+            sockaddr_un address = {};
+            address.sun_family = AF_UNIX;
+            if (path.size() >= sizeof(address.sun_path)) {
+                throw std::runtime_error("Metrics socket path is too long: " + path);
+            }
+            path.copy(address.sun_path, path.size());
+            ::unlink(path.c_str()); // left behind by an earlier run
+            listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd, 8) != 0) {
+                if (listenFd >= 0) ::close(listenFd);
+                throw std::runtime_error("Failed to listen on metrics socket: " + path);
+            }
+        }
+        thread = std::thread(&MetricsPublisher::loop, this);
+    }
+    ~MetricsPublisher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        stopped.notify_all();
+        thread.join();
+        if (socketMode) {
+            ::close(listenFd);
+            ::unlink(path.c_str());
+        }
+    }
+    MetricsPublisher(const MetricsPublisher&) = delete;
+    MetricsPublisher& operator=(const MetricsPublisher&) = delete;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <fcntl.h>    // for open
+#include <sys/mman.h> // for mmap
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for close
+
+// A whole file mapped copy-on-write. Pages are read in when first touched and the
+// first write to a page gives the process its own copy, so the file never changes
+// and every mapping of it starts from the same contents.
+class MappedFile {
+private:
+    std::string path;
+    void* base = MAP_FAILED;
+    size_t length = 0;
+
+public:
+    explicit MappedFile(const std::string& pPath) : path(pPath) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open mapped file: " + path);
+        }
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            length = static_cast<size_t>(info.st_size);
+            base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd); // the mapping keeps the file
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("Failed to map file: " + path);
+        }
+    }
+    ~MappedFile() { munmap(base, length); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    char* data() { return static_cast<char*>(base); }
+    const char* data() const { return static_cast<const char*>(base); }
+    size_t size() const { return length; }
+    const std::string& getPath() const { return path; }
+};
+
+// Allocator for std::vector columns that can start out inside a mapping. The first
+// allocation that fits takes the adopted memory, and elements made without a value
+// are left as they are, so reserve() then resize() shows the mapped values with no
+// copy. Growing past it moves to the heap as usual. The allocator shares ownership of
+// the mapping, so a vector still using it keeps it mapped after the snapshot is gone.
+// Only the vector it was given to (and whatever that vector is moved or swapped into)
+// uses the adopted memory: a copied vector or a rebound allocator starts on the heap.
+template <typename T>
+class MappedAllocator {
+private:
+    template <typename U>
+    friend class MappedAllocator;
+    std::shared_ptr<MappedFile> mapping; // keeps adopted valid
+    T* adopted = nullptr;
+    size_t adoptedCount = 0;
+    bool taken = false;
+
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    MappedAllocator() = default;
+    MappedAllocator(std::shared_ptr<MappedFile> pMapping, T* pAdopted, size_t count)
+        : mapping(std::move(pMapping)), adopted(pAdopted), adoptedCount(count) {}
+    template <typename U>
+    MappedAllocator(const MappedAllocator<U>&) {} // a rebound copy adopts nothing
+
+    // a copied vector gets its own memory rather than a second claim on the mapping
+    MappedAllocator select_on_container_copy_construction() const { return MappedAllocator(); }
+
+    T* allocate(size_t n) {
+        if (adopted && !taken && n <= adoptedCount) {
+            taken = true;
+            return adopted;
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t) {
+        if (p != adopted) ::operator delete(p);
+    }
+
+    // default rather than value initialization, which would overwrite the mapping
+    template <typename U>
+    void construct(U* p) {
+        ::new (static_cast<void*>(p)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    bool operator==(const MappedAllocator<U>& other) const { return static_cast<const void*>(adopted) == static_cast<const void*>(other.adopted); }
+    template <typename U>
+    bool operator!=(const MappedAllocator<U>& other) const { return !(*this == other); }
+};
+
+#endif
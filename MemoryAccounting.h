@@ -0,0 +1,96 @@
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// Subsystems whose heap usage is tracked separately
+enum class MemoryCategory {
+    Population,       // the snails themselves
+    SpatialIndex,     // region lookup / spatial structures
+    CollectorHistory, // per tick data kept by the collector
+    OutputBuffers,    // results staged for writing
+    Count
+};
+
+const int MEMORY_CATEGORIES = static_cast<int>(MemoryCategory::Count);
+
+inline const char* memoryCategoryName(int category) {
+    static const char* names[MEMORY_CATEGORIES] = {"population", "spatialIndex", "collectorHistory", "outputBuffers"};
+    return names[category];
+}
+
+// Current and high-water bytes per category. Owners report their size with set();
+// the ledger only remembers the numbers, so it costs nothing to keep around.
+class MemoryLedger {
+private:
+    size_t current[MEMORY_CATEGORIES] = {};
+    size_t peak[MEMORY_CATEGORIES] = {};
+    size_t totalPeak = 0;
+
+public:
+    void set(MemoryCategory category, size_t bytes) {
+        int i = static_cast<int>(category);
+        current[i] = bytes;
+        peak[i] = std::max(peak[i], bytes);
+        totalPeak = std::max(totalPeak, getTotal());
+    }
+    size_t getCurrent(int category) const { return current[category]; }
+    size_t getPeak(int category) const { return peak[category]; }
+    size_t getTotal() const {
+        size_t total = 0;
+        for (int i = 0; i < MEMORY_CATEGORIES; i++) {
+            total += current[i];
+        }
+        return total;
+    }
+    size_t getTotalPeak() const { return totalPeak; }
+
+    // keeps the larger high-water marks, used to roll runs up into a sweep
+    void merge(const MemoryLedger& other) {
+        for (int i = 0; i < MEMORY_CATEGORIES; i++) {
+            peak[i] = std::max(peak[i], other.peak[i]);
+            current[i] = other.current[i];
+        }
+        totalPeak = std::max(totalPeak, other.totalPeak);
+    }
+    void setPeak(int category, size_t bytes) { peak[category] = bytes; }
+    void setTotalPeak(size_t bytes) { totalPeak = bytes; }
+};
+
+// heap bytes behind common containers
+template <typename T, typename Alloc>
+size_t vectorBytes(const std::vector<T, Alloc>& v) {
+    return v.capacity() * sizeof(T);
+}
+
+inline size_t stringBytes(const std::string& s) {
+    // short strings live inside the object (SSO) and cost nothing extra
+    return s.capacity() > 15 ? s.capacity() + 1 : 0;
+}
+
+// resident set size of this process, in bytes
+inline size_t currentRss() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0;
+    size_t residentPages = 0;
+    if (!(statm >> pages >> residentPages)) {
+        return 0;
+    }
+    return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+inline size_t peakRss() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return static_cast<size_t>(usage.ru_maxrss) * 1024; // Linux reports kilobytes
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// SplitMix64 finaliser, a good 64 bit mix of its input
+inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Lemire's multiply-shift: the high half of a 32 bit draw times n, with the few
+// biased low values rejected; the division only happens when a draw lands near them
+template <typename Generator>
+uint32_t boundedBelow(Generator& g, uint32_t n) {
+    uint64_t m = static_cast<uint64_t>(static_cast<uint32_t>(g.next() >> 32)) * n;
+    uint32_t low = static_cast<uint32_t>(m);
+    if (low < n) {
+        uint32_t threshold = (0u - n) % n;
+        while (low < threshold) {
+            m = static_cast<uint64_t>(static_cast<uint32_t>(g.next() >> 32)) * n;
+            low = static_cast<uint32_t>(m);
+        }
+    }
+    return static_cast<uint32_t>(m >> 32);
+}
+
+// count values in [0, n), two per 64 bit draw, the rejection threshold worked out once
+template <typename Generator>
+void fillBounded(Generator& g, uint32_t* out, size_t count, uint32_t n) {
+    uint32_t threshold = (0u - n) % n;
+    size_t i = 0;
+    while (i < count) {
+        uint64_t bits = g.next();
+        uint32_t halves[2] = {static_cast<uint32_t>(bits >> 32), static_cast<uint32_t>(bits)};
+        for (uint32_t half : halves) {
+            uint64_t m = static_cast<uint64_t>(half) * n;
+            if (static_cast<uint32_t>(m) < threshold) continue;
+            out[i++] = static_cast<uint32_t>(m >> 32);
+            if (i == count) break;
+        }
+    }
+}
+
+// in (0, 1), from the top 53 bits
+inline double unitFromBits(uint64_t bits) {
+    return (static_cast<double>(bits >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+// xoshiro256**: small, fast and good enough for simulation. Also a standard uniform
+// random bit generator, so the <random> distributions can run on it.
+class Xoshiro256 {
+private:
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+public:
+    using result_type = uint64_t;
+
+    explicit Xoshiro256(uint64_t seed = 1) { reseed(seed); }
+
+    // the state is filled from SplitMix64, as the authors recommend
+    void reseed(uint64_t seed) {
+        for (uint64_t& word : s) {
+            seed += 0x9e3779b97f4a7c15ULL;
+            word = mix64(seed);
+        }
+    }
+
+    uint64_t next() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+    uint32_t below(uint32_t n) { return boundedBelow(*this, n); }
+    void fillBelow(uint32_t* out, size_t count, uint32_t n) { fillBounded(*this, out, count, n); }
+    double unit() { return unitFromBits(next()); }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint64_t>::max(); }
+    result_type operator()() { return next(); }
+};
+
+// Counter based stream: the state is just a key and a counter, so any stream can be
+// started anywhere from (seed, key) alone. Work split over threads gets the same
+// numbers as long as each piece of work keys its own stream.
+class StreamRng {
+private:
+    uint64_t state;
+
+public:
+    // keys are mixed one after another, e.g. (tick, block, phase)
+    StreamRng(uint64_t seed, uint64_t key1, uint64_t key2 = 0, uint64_t key3 = 0)
+        : state(mix64(mix64(mix64(seed ^ mix64(key1)) ^ key2) ^ key3)) {}
+
+    uint64_t next() {
+        state += 0x9e3779b97f4a7c15ULL;
+        return mix64(state);
+    }
+    uint32_t below(uint32_t n) { return boundedBelow(*this, n); }
+    void fillBelow(uint32_t* out, size_t count, uint32_t n) { fillBounded(*this, out, count, n); }
+    double unit() { return unitFromBits(next()); }
+};
+
+#endif
@@ -0,0 +1,200 @@
+#ifndef REGIONINDEX_H
+#define REGIONINDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Inclusive cell rectangle
+struct IndexRect {
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+
+    bool contains(int x, int y) const { return x >= minX && x <= maxX && y >= minY && y <= maxY; }
+    bool overlaps(const IndexRect& o) const { return maxX >= o.minX && minX <= o.maxX && maxY >= o.minY && minY <= o.maxY; }
+    bool contains(const IndexRect& o) const { return o.minX >= minX && o.maxX <= maxX && o.minY >= minY && o.maxY <= maxY; }
+};
+
+// Finds the first rectangle (lowest index) holding a cell. The bounds are cut into
+// uniform bins, each with the rectangles that overlap it, so a lookup only checks a
+// handful of rectangles however many there are. A bin lying wholly inside its first
+// rectangle answers without looking at any.
+class RegionIndex {
+private:
+    static constexpr int32_t MIXED = -1;
+
+    std::vector<IndexRect> rects;
+    IndexRect bounds = {0, 0, -1, -1};
+    int binSize = 1;
+    int binsX = 0;
+    int binsY = 0;
+    std::vector<int32_t> whole;        // bin -> rectangle covering all of it, or MIXED
+    std::vector<uint32_t> binStart;    // bin -> first entry in candidates, plus an end marker
+    std::vector<uint32_t> candidates;  // rectangles overlapping each bin, ascending
+
+    int binOf(int v, int origin) const { return (v - origin) / binSize; }
+    IndexRect binRect(int bx, int by) const {
+        IndexRect r = {bounds.minX + bx * binSize, bounds.minY + by * binSize, 0, 0};
+        r.maxX = std::min(r.minX + binSize - 1, bounds.maxX);
+        r.maxY = std::min(r.minY + binSize - 1, bounds.maxY);
+        return r;
+    }
+    int scan(int x, int y) const {
+        for (size_t i = 0; i < rects.size(); i++) {
+            if (rects[i].contains(x, y)) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+public:
+    // lookups outside bounds still work, they just fall back to a scan
+    void build(const std::vector<IndexRect>& pRects, const IndexRect& pBounds) {
+        rects = pRects;
+        bounds = pBounds;
+        long long extentX = static_cast<long long>(bounds.maxX) - bounds.minX + 1;
+        long long extentY = static_cast<long long>(bounds.maxY) - bounds.minY + 1;
+        if (extentX <= 0 || extentY <= 0) {
+            binsX = binsY = 0;
+            return;
+        }
+        // bins no smaller than the smallest rectangle, and about four per rectangle
+        long long smallest = std::max(extentX, extentY);
+        for (const IndexRect& r : rects) {
+            smallest = std::min(smallest, std::max<long long>(1, std::min<long long>(r.maxX - r.minX + 1, r.maxY - r.minY + 1)));
+        }
+        double perRect = std::sqrt(static_cast<double>(extentX) * extentY / (4.0 * std::max<size_t>(1, rects.size())));
+        binSize = static_cast<int>(std::max<long long>(1, std::max<long long>(smallest, static_cast<long long>(perRect))));
+        binsX = static_cast<int>((extentX + binSize - 1) / binSize);
+        binsY = static_cast<int>((extentY + binSize - 1) / binSize);
+        size_t numBins = static_cast<size_t>(binsX) * binsY;
+
+        // two passes over the rectangles: count per bin, then fill
+        binStart.assign(numBins + 1, 0);
+        for (int pass = 0; pass < 2; pass++) {
+            std::vector<uint32_t> fill(binStart.begin(), binStart.end() - 1);
+            for (size_t i = 0; i < rects.size(); i++) {
+                const IndexRect& r = rects[i];
+                if (!r.overlaps(bounds)) continue;
+                int bx0 = binOf(std::max(r.minX, bounds.minX), bounds.minX);
+                int bx1 = binOf(std::min(r.maxX, bounds.maxX), bounds.minX);
+                int by0 = binOf(std::max(r.minY, bounds.minY), bounds.minY);
+                int by1 = binOf(std::min(r.maxY, bounds.maxY), bounds.minY);
+                for (int by = by0; by <= by1; by++) {
+                    for (int bx = bx0; bx <= bx1; bx++) {
+                        size_t bin = static_cast<size_t>(by) * binsX + bx;
+                        if (pass == 0) {
+                            binStart[bin + 1]++;
+                        } else {
+                            candidates[fill[bin]++] = static_cast<uint32_t>(i);
+                        }
+                    }
+                }
+            }
+            if (pass == 0) {
+                for (size_t bin = 0; bin < numBins; bin++) {
+                    binStart[bin + 1] += binStart[bin];
+                }
+                candidates.assign(binStart.back(), 0);
+            }
+        }
+        whole.assign(numBins, MIXED);
+        for (int by = 0; by < binsY; by++) {
+            for (int bx = 0; bx < binsX; bx++) {
+                size_t bin = static_cast<size_t>(by) * binsX + bx;
+                if (binStart[bin] == binStart[bin + 1]) continue;
+                uint32_t first = candidates[binStart[bin]];
+                if (rects[first].contains(binRect(bx, by))) whole[bin] = static_cast<int32_t>(first);
+            }
+        }
+    }
+
+    size_t size() const { return rects.size(); }
+    const IndexRect& rect(size_t i) const { return rects[i]; }
+
+    // first rectangle holding the cell, or -1
+    int find(int x, int y) const {
+        if (!bounds.contains(x, y) || binsX == 0) return scan(x, y);
+        size_t bin = static_cast<size_t>(binOf(y, bounds.minY)) * binsX + binOf(x, bounds.minX);
+        if (whole[bin] != MIXED) return whole[bin];
+        for (uint32_t k = binStart[bin]; k < binStart[bin + 1]; k++) {
+            if (rects[candidates[k]].contains(x, y)) return static_cast<int>(candidates[k]);
+        }
+        return -1;
+    }
+
+    // the rectangle every cell of area (clipped to the bounds) falls in, or -1 if they differ
+    int findRect(IndexRect area) const {
+        area.minX = std::max(area.minX, bounds.minX);
+        area.maxX = std::min(area.maxX, bounds.maxX);
+        area.minY = std::max(area.minY, bounds.minY);
+        area.maxY = std::min(area.maxY, bounds.maxY);
+        if (area.minX > area.maxX || area.minY > area.maxY || binsX == 0) return -1;
+        // the first rectangle to touch the area decides it, so take the lowest overlapping one
+        uint32_t first = static_cast<uint32_t>(rects.size());
+        for (int by = binOf(area.minY, bounds.minY); by <= binOf(area.maxY, bounds.minY); by++) {
+            for (int bx = binOf(area.minX, bounds.minX); bx <= binOf(area.maxX, bounds.minX); bx++) {
+                size_t bin = static_cast<size_t>(by) * binsX + bx;
+                for (uint32_t k = binStart[bin]; k < binStart[bin + 1] && candidates[k] < first; k++) {
+                    if (rects[candidates[k]].overlaps(area)) first = candidates[k];
+                }
+            }
+        }
+        if (first == rects.size() || !rects[first].contains(area)) return -1;
+        return static_cast<int>(first);
+    }
+
+    // a cell of the bounds no rectangle holds, if there is one; only bins that are
+    // not wholly inside one rectangle are walked cell by cell
+    bool findUncovered(int& x, int& y) const {
+        for (int by = 0; by < binsY; by++) {
+            for (int bx = 0; bx < binsX; bx++) {
+                size_t bin = static_cast<size_t>(by) * binsX + bx;
+                if (whole[bin] != MIXED) continue;
+                IndexRect r = binRect(bx, by);
+                for (int cy = r.minY; cy <= r.maxY; cy++) {
+                    for (int cx = r.minX; cx <= r.maxX; cx++) {
+                        if (find(cx, cy) < 0) {
+                            x = cx;
+                            y = cy;
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    // cells of the bounds each rectangle is the first to hold; whole bins count at once
+    std::vector<long long> cellCounts() const {
+        std::vector<long long> cells(rects.size(), 0);
+        for (int by = 0; by < binsY; by++) {
+            for (int bx = 0; bx < binsX; bx++) {
+                size_t bin = static_cast<size_t>(by) * binsX + bx;
+                IndexRect r = binRect(bx, by);
+                if (whole[bin] != MIXED) {
+                    cells[whole[bin]] += static_cast<long long>(r.maxX - r.minX + 1) * (r.maxY - r.minY + 1);
+                    continue;
+                }
+                for (int cy = r.minY; cy <= r.maxY; cy++) {
+                    for (int cx = r.minX; cx <= r.maxX; cx++) {
+                        int i = find(cx, cy);
+                        if (i >= 0) cells[i] += 1;
+                    }
+                }
+            }
+        }
+        return cells;
+    }
+
+    size_t bytes() const {
+        return rects.capacity() * sizeof(IndexRect) + whole.capacity() * sizeof(int32_t) +
+               binStart.capacity() * sizeof(uint32_t) + candidates.capacity() * sizeof(uint32_t);
+    }
+};
+
+#endif
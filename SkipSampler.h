@@ -0,0 +1,61 @@
+#ifndef SKIPSAMPLER_H
+#define SKIPSAMPLER_H
+
+#include <cmath>
+#include <limits>
+
+// A run of Bernoulli(p) trials decided by counting down to the next success instead
+// of drawing once per trial. The gap before a success is geometric, drawn by
+// inversion from one uniform, so random numbers are only spent on successes. The
+// gap is memoryless, so one sampler can be shared by any number of trial sources.
+class SkipSampler {
+private:
+    double logFail = 0;  // log(1 - p)
+    long long gap = -1;  // failures left before the next success, -1 until the first draw
+    bool never = true;   // p == 0
+
+public:
+    explicit SkipSampler(double p = 0) { setProb(p); }
+
+    void setProb(double p) {
+        never = p <= 0;
+        logFail = p >= 1 ? -std::numeric_limits<double>::infinity() : std::log1p(-p);
+        gap = -1;
+    }
+
+    // failures before the next success; uniform() has to return a value in (0, 1)
+    template <typename Uniform>
+    long long drawGap(Uniform uniform) const {
+        if (never) return std::numeric_limits<long long>::max();
+        double g = std::floor(std::log(uniform()) / logFail);
+        return g >= static_cast<double>(std::numeric_limits<long long>::max()) ? std::numeric_limits<long long>::max() : static_cast<long long>(g);
+    }
+
+    // one trial
+    template <typename Uniform>
+    bool trial(Uniform uniform) {
+        if (gap < 0) gap = drawGap(uniform);
+        if (gap == 0) {
+            gap = drawGap(uniform);
+            return true;
+        }
+        gap--;
+        return false;
+    }
+
+    // count trials at once: calls hit(k) for the index of every success, in order
+    template <typename Uniform, typename Hit>
+    void trials(long long count, Uniform uniform, Hit hit) {
+        if (gap < 0) gap = drawGap(uniform);
+        long long k = 0;
+        while (count - k > gap) {
+            k += gap;
+            hit(k);
+            k++;
+            gap = drawGap(uniform);
+        }
+        gap -= count - k;
+    }
+};
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef SPARSEOCCUPANCY_H
+#define SPARSEOCCUPANCY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Which square tiles of the plane hold something, and which rows are in each.
+// Tiles are allocated only where rows are, in a hash table keyed by tile, and the
+// rows are grouped by tile with a counting sort on every rebuild. Snails move one
+// cell per tick, so most rows are still in the tile they were in last time and skip
+// the hash lookup. Tiles that empty out are dropped once they outnumber the
+// occupied ones, so memory follows the occupied area, not the extent of the swamp.
+class SparseOccupancy {
+private:
+    static constexpr uint32_t EMPTY = 0xffffffffu;
+
+    int tileSize;
+    std::vector<uint32_t> table;     // open addressing, tile key -> slot
+    std::vector<uint64_t> tileKeys;  // slot -> tile key
+    std::vector<uint32_t> tileStart; // slot -> first entry in rows, plus an end marker
+    std::vector<uint32_t> rows;      // row ids grouped by tile
+    std::vector<uint32_t> rowTile;   // row id -> slot, EMPTY for rows that were skipped
+    size_t occupied = 0;
+    bool slotsMoved = false;
+
+    static uint64_t tileKey(int tileX, int tileY) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(tileX)) << 32) | static_cast<uint32_t>(tileY);
+    }
+    static uint64_t mix(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key;
+    }
+    int floorDiv(int v) const {
+        return v >= 0 ? v / tileSize : -((-v + tileSize - 1) / tileSize);
+    }
+    void rehash(size_t tableSize) {
+        table.assign(tableSize, EMPTY);
+        for (uint32_t slot = 0; slot < tileKeys.size(); slot++) {
+            place(tileKeys[slot], slot);
+        }
+    }
+    void place(uint64_t key, uint32_t slot) {
+        size_t mask = table.size() - 1;
+        size_t i = mix(key) & mask;
+        while (table[i] != EMPTY) i = (i + 1) & mask;
+        table[i] = slot;
+    }
+    uint32_t find(uint64_t key) const {
+        if (table.empty()) return EMPTY;
+        size_t mask = table.size() - 1;
+        for (size_t i = mix(key) & mask; table[i] != EMPTY; i = (i + 1) & mask) {
+            if (tileKeys[table[i]] == key) return table[i];
+        }
+        return EMPTY;
+    }
+    uint32_t findOrAdd(uint64_t key) {
+        uint32_t slot = find(key);
+        if (slot != EMPTY) return slot;
+        slot = static_cast<uint32_t>(tileKeys.size());
+        tileKeys.push_back(key);
+        if (tileKeys.size() * 2 > table.size()) {
+            rehash(table.empty() ? 64 : table.size() * 2);
+        } else {
+            place(key, slot);
+        }
+        return slot;
+    }
+    // drops the tiles that no row is in any more
+    void purge(const std::vector<uint32_t>& counts) {
+        std::vector<uint32_t> newSlot(tileKeys.size(), EMPTY);
+        size_t kept = 0;
+        for (size_t slot = 0; slot < tileKeys.size(); slot++) {
+            if (counts[slot] == 0) continue;
+            newSlot[slot] = static_cast<uint32_t>(kept);
+            tileKeys[kept++] = tileKeys[slot];
+        }
+        tileKeys.resize(kept);
+        tileKeys.shrink_to_fit();
+        for (uint32_t& slot : rowTile) {
+            if (slot != EMPTY) slot = newSlot[slot];
+        }
+        size_t tableSize = 64;
+        while (tableSize < kept * 2) tableSize *= 2;
+        std::vector<uint32_t>().swap(table);
+        rehash(tableSize);
+        slotsMoved = true;
+    }
+
+public:
+    explicit SparseOccupancy(int pTileSize = 16) : tileSize(pTileSize > 0 ? pTileSize : 1) {}
+
+    // rows with a zero in include are left out (dead snails)
+    void rebuild(const int* xs, const int* ys, const uint8_t* include, size_t n) {
+        rowTile.resize(n, EMPTY);
+        slotsMoved = false;
+        std::vector<uint32_t> counts(tileKeys.size(), 0);
+        for (size_t i = 0; i < n; i++) {
+            if (!include[i]) {
+                rowTile[i] = EMPTY;
+                continue;
+            }
+            uint64_t key = tileKey(floorDiv(xs[i]), floorDiv(ys[i]));
+            uint32_t slot = rowTile[i];
+            // a stale guess is harmless: a slot whose key matches is the tile
+            if (slot >= tileKeys.size() || tileKeys[slot] != key) {
+                slot = findOrAdd(key);
+                if (slot == counts.size()) counts.push_back(0);
+            }
+            counts[slot]++;
+            rowTile[i] = slot;
+        }
+        occupied = 0;
+        for (uint32_t count : counts) {
+            if (count) occupied++;
+        }
+        if (tileKeys.size() > 64 && tileKeys.size() > 2 * occupied) {
+            purge(counts);
+            std::vector<uint32_t> kept;
+            for (uint32_t count : counts) {
+                if (count) kept.push_back(count);
+            }
+            counts.swap(kept);
+        }
+
+        // counts -> start offsets, then drop every row into its tile
+        tileStart.assign(counts.size() + 1, 0);
+        for (size_t slot = 0; slot < counts.size(); slot++) {
+            tileStart[slot + 1] = tileStart[slot] + counts[slot];
+        }
+        rows.resize(tileStart.back());
+        std::vector<uint32_t>& fill = counts;
+        std::copy(tileStart.begin(), tileStart.end() - 1, fill.begin());
+        for (size_t i = 0; i < n; i++) {
+            if (rowTile[i] != EMPTY) rows[fill[rowTile[i]]++] = static_cast<uint32_t>(i);
+        }
+    }
+
+    int getTileSize() const { return tileSize; }
+    size_t occupiedTiles() const { return occupied; }
+    // tile slots in use, including tiles that emptied since they were last dropped
+    size_t tileCount() const { return tileKeys.size(); }
+    // true when the last rebuild renumbered the tiles, invalidating anything kept per slot
+    bool slotsRenumbered() const { return slotsMoved; }
+    // slot of the tile a row was in at the last rebuild, or -1
+    long long tileOf(size_t row) const {
+        return row < rowTile.size() && rowTile[row] != EMPTY ? rowTile[row] : -1;
+    }
+    // cell bounds of a tile, inclusive
+    void tileBounds(size_t slot, int& minX, int& minY, int& maxX, int& maxY) const {
+        int tileX = static_cast<int32_t>(tileKeys[slot] >> 32);
+        int tileY = static_cast<int32_t>(tileKeys[slot] & 0xffffffffu);
+        minX = tileX * tileSize;
+        minY = tileY * tileSize;
+        maxX = minX + tileSize - 1;
+        maxY = minY + tileSize - 1;
+    }
+
+    // calls visit(rows, count) for every occupied tile overlapping the rectangle;
+    // the rows are only candidates, the caller checks exact positions
+    template <typename Visitor>
+    void forEachTileInRect(int minX, int minY, int maxX, int maxY, Visitor visit) const {
+        int minTileX = floorDiv(minX);
+        int maxTileX = floorDiv(maxX);
+        int minTileY = floorDiv(minY);
+        int maxTileY = floorDiv(maxY);
+        long long spanned = static_cast<long long>(maxTileX - minTileX + 1) * (maxTileY - minTileY + 1);
+        if (spanned > static_cast<long long>(tileKeys.size())) {
+            // fewer occupied tiles than tiles under the rectangle: walk the occupied ones
+            for (size_t slot = 0; slot < tileKeys.size(); slot++) {
+                int tileX = static_cast<int32_t>(tileKeys[slot] >> 32);
+                int tileY = static_cast<int32_t>(tileKeys[slot] & 0xffffffffu);
+                if (tileX < minTileX || tileX > maxTileX || tileY < minTileY || tileY > maxTileY) continue;
+                if (tileStart[slot + 1] == tileStart[slot]) continue;
+                visit(&rows[tileStart[slot]], tileStart[slot + 1] - tileStart[slot]);
+            }
+            return;
+        }
+        for (int tileX = minTileX; tileX <= maxTileX; tileX++) {
+            for (int tileY = minTileY; tileY <= maxTileY; tileY++) {
+                uint32_t slot = find(tileKey(tileX, tileY));
+                if (slot == EMPTY || tileStart[slot + 1] == tileStart[slot]) continue;
+                visit(&rows[tileStart[slot]], tileStart[slot + 1] - tileStart[slot]);
+            }
+        }
+    }
+
+    size_t bytes() const {
+        return table.capacity() * sizeof(uint32_t) + tileKeys.capacity() * sizeof(uint64_t) +
+               tileStart.capacity() * sizeof(uint32_t) + rows.capacity() * sizeof(uint32_t) +
+               rowTile.capacity() * sizeof(uint32_t);
+    }
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads for data parallel loops. parallelFor hands out indices one
+// at a time from a shared counter, the calling thread works too, and it returns once
+// every index is done. What runs where is not fixed, so callers that need
+// reproducible results make each index independent of the others.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::function<void(size_t)> job;
+    std::atomic<size_t> nextIndex{0};
+    size_t jobSize = 0;
+    size_t generation = 0; // bumped for every job, so workers know there is new work
+    size_t busy = 0;       // workers still inside the current job
+    bool stopping = false;
+    std::exception_ptr failure;
+
+    void work() {
+        for (size_t i = nextIndex.fetch_add(1); i < jobSize; i = nextIndex.fetch_add(1)) {
+            try {
+                job(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!failure) failure = std::current_exception();
+            }
+        }
+    }
+    void workerLoop() {
+        size_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            work();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy == 0) finished.notify_one();
+        }
+    }
+
+public:
+    // threads counts the caller, so 1 means no extra threads at all
+    explicit ThreadPool(unsigned threads = 1) {
+        for (unsigned t = 1; t < threads; t++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // runs f(i) for every i in [0, count); rethrows the first exception f threw
+    void parallelFor(size_t count, std::function<void(size_t)> f) {
+        if (workers.empty() || count <= 1) {
+            for (size_t i = 0; i < count; i++) f(i);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = std::move(f);
+            jobSize = count;
+            nextIndex = 0;
+            busy = workers.size();
+            failure = nullptr;
+            generation++;
+        }
+        wake.notify_all();
+        work();
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return busy == 0; });
+        job = nullptr;
+        if (failure) std::rethrow_exception(failure);
+    }
+};
+
+#endif
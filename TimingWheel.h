@@ -0,0 +1,55 @@
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+// Buckets of events keyed by tick modulo the horizon. Scheduling and firing cost
+// O(1) per event and a tick only looks at the events that fall on it.
+template <typename T>
+class TimingWheel {
+private:
+    std::vector<std::vector<T>> buckets;
+    int nextTick = 0; // first tick that has not been fired yet
+
+public:
+    // horizon is the furthest an event can be scheduled ahead of the next tick
+    explicit TimingWheel(int horizon = 0, int startTick = 0)
+        : buckets(horizon + 1), nextTick(startTick) {}
+
+    void schedule(int tick, const T& event) {
+        if (tick < nextTick || tick - nextTick >= static_cast<int>(buckets.size())) {
+            throw std::out_of_range("Event outside the timing wheel horizon");
+        }
+        buckets[tick % buckets.size()].push_back(event);
+    }
+
+    // hands every event due at tick to handler, then moves on to the next tick
+    template <typename Handler>
+    void fire(int tick, Handler handler) {
+        std::vector<T>& bucket = buckets[tick % buckets.size()];
+        for (const T& event : bucket) {
+            handler(event);
+        }
+        bucket.clear();
+        nextTick = tick + 1;
+    }
+
+    // drops every pending event, e.g. before rescheduling after the owner moved things
+    void clear() {
+        for (std::vector<T>& bucket : buckets) {
+            bucket.clear();
+        }
+    }
+
+    size_t bytes() const {
+        size_t total = buckets.capacity() * sizeof(std::vector<T>);
+        for (const std::vector<T>& bucket : buckets) {
+            total += bucket.capacity() * sizeof(T);
+        }
+        return total;
+    }
+};
+
+#endif
@@ -0,0 +1,303 @@
+#ifndef TRAJECTORYCODEC_H
+#define TRAJECTORYCODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "Random.h"
+
+// LEB128 varints, with zigzag for signed values so small negatives stay small
+inline void putVarint(std::ostream& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.put(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.put(static_cast<char>(value));
+}
+inline bool getVarint(std::istream& in, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = in.get();
+        if (c == std::char_traits<char>::eof()) return false;
+        value |= static_cast<uint64_t>(c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+inline uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+inline int64_t unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+// Positions of many snails, one track per snail over consecutive ticks. A snail
+// moves at most one cell per axis per tick, so after a keyframe each tick is a 4 bit
+// code, 2 bits per axis. Tracks are chains of fixed size blocks from one pool,
+// each block a keyframe and up to 62 codes: 44 bytes for 63 ticks instead of 504.
+// A longer step just starts a new block early. Finding a tick walks the chain and
+// decodes at most one block. The pool grows a chunk at a time, so it is never
+// copied and wastes at most one chunk; the blocks of a restarted track are reused.
+class TrajectoryStore {
+public:
+    static const int BLOCK_TICKS = 63;
+
+private:
+    static const uint32_t NONE = 0xffffffffu;
+    static const uint32_t CHUNK_BLOCKS = 4096;
+    struct Block {
+        int32_t x;         // keyframe, the position at the block's first tick
+        int32_t y;
+        uint32_t next;     // next block of the track, or NONE
+        uint8_t count;     // ticks in the block, keyframe included
+        uint8_t codes[31]; // (dx + 1) | (dy + 1) << 2 per tick after the keyframe, two per byte
+    };
+    struct Track {
+        int32_t firstTick;
+        int32_t length;
+        uint32_t first;
+        uint32_t last;
+        int32_t lastX;
+        int32_t lastY;
+    };
+
+    std::vector<std::vector<Block>> chunks;
+    uint32_t numBlocks = 0;
+    std::vector<uint32_t> freeBlocks;
+    std::vector<Track> tracks;
+
+    Block& block(uint32_t b) { return chunks[b / CHUNK_BLOCKS][b % CHUNK_BLOCKS]; }
+    const Block& block(uint32_t b) const { return chunks[b / CHUNK_BLOCKS][b % CHUNK_BLOCKS]; }
+    uint32_t newBlock(int x, int y) {
+        Block b = {};
+        b.x = x;
+        b.y = y;
+        b.next = NONE;
+        b.count = 1;
+        if (!freeBlocks.empty()) {
+            uint32_t reused = freeBlocks.back();
+            freeBlocks.pop_back();
+            block(reused) = b;
+            return reused;
+        }
+        if (numBlocks % CHUNK_BLOCKS == 0) {
+            chunks.emplace_back();
+            chunks.back().reserve(CHUNK_BLOCKS);
+        }
+        chunks.back().push_back(b);
+        return numBlocks++;
+    }
+    static int code(const Block& block, int k) { return (block.codes[k >> 1] >> (4 * (k & 1))) & 0xf; }
+
+public:
+    size_t size() const { return tracks.size(); }
+    int firstTick(size_t track) const { return tracks[track].firstTick; }
+    int length(size_t track) const { return tracks[track].length; }
+
+    // a new track, at its first tick; returns its number
+    uint32_t start(int tick, int x, int y) {
+        uint32_t block = newBlock(x, y);
+        tracks.push_back(Track{tick, 1, block, block, x, y});
+        return static_cast<uint32_t>(tracks.size() - 1);
+    }
+    // throws the track away and starts it again, for another snail
+    void restart(uint32_t track, int tick, int x, int y) {
+        Track& t = tracks[track];
+        for (uint32_t b = t.first; b != NONE; b = block(b).next) freeBlocks.push_back(b);
+        uint32_t first = newBlock(x, y);
+        t = Track{tick, 1, first, first, x, y};
+    }
+    // where the snail is at the track's next tick
+    void append(uint32_t track, int x, int y) {
+        Track& t = tracks[track];
+        int dx = x - t.lastX;
+        int dy = y - t.lastY;
+        t.lastX = x;
+        t.lastY = y;
+        t.length++;
+        Block& last = block(t.last);
+        if (std::abs(dx) > 1 || std::abs(dy) > 1 || last.count == BLOCK_TICKS) {
+            uint32_t b = newBlock(x, y);
+            last.next = b;
+            t.last = b;
+            return;
+        }
+        int k = last.count - 1;
+        last.codes[k >> 1] |= static_cast<uint8_t>(((dx + 1) | (dy + 1) << 2) << (4 * (k & 1)));
+        last.count++;
+    }
+
+    // position at a tick of the track; false outside it
+    bool positionAt(size_t track, int tick, int& x, int& y) const {
+        const Track& t = tracks[track];
+        int k = tick - t.firstTick;
+        if (k < 0 || k >= t.length) return false;
+        const Block* b = &block(t.first);
+        while (k >= b->count) {
+            k -= b->count;
+            b = &block(b->next);
+        }
+        x = b->x;
+        y = b->y;
+        for (int j = 0; j < k; j++) {
+            int c = code(*b, j);
+            x += (c & 3) - 1;
+            y += (c >> 2) - 1;
+        }
+        return true;
+    }
+    // visit(tick, x, y) for every tick of the track, in order
+    template <typename Visit>
+    void forEachPoint(size_t track, Visit visit) const {
+        int tick = tracks[track].firstTick;
+        for (uint32_t b = tracks[track].first; b != NONE; b = block(b).next) {
+            const Block& current = block(b);
+            int x = current.x;
+            int y = current.y;
+            visit(tick++, x, y);
+            for (int j = 0; j + 1 < current.count; j++) {
+                int c = code(current, j);
+                x += (c & 3) - 1;
+                y += (c >> 2) - 1;
+                visit(tick++, x, y);
+            }
+        }
+    }
+
+    size_t bytes() const {
+        return chunks.size() * CHUNK_BLOCKS * sizeof(Block) + chunks.capacity() * sizeof(std::vector<Block>) +
+               freeBlocks.capacity() * sizeof(uint32_t) + tracks.capacity() * sizeof(Track);
+    }
+
+    // On disk every number is a varint: the track count, then per track its first tick
+    // (zigzag, as a step from the previous track's), length and block count, then per
+    // block its tick count, its keyframe as zigzag steps from the previous keyframe and
+    // its codes, count / 2 bytes. A track's first keyframe steps from the previous
+    // track's first one, since litter mates start on the same tick in the same cell.
+    void write(std::ostream& out) const {
+        putVarint(out, tracks.size());
+        int64_t startTick = 0;
+        int64_t startX = 0;
+        int64_t startY = 0;
+        for (const Track& t : tracks) {
+            size_t trackBlocks = 0;
+            for (uint32_t b = t.first; b != NONE; b = block(b).next) trackBlocks++;
+            putVarint(out, zigzag(t.firstTick - startTick));
+            putVarint(out, static_cast<uint64_t>(t.length));
+            putVarint(out, trackBlocks);
+            startTick = t.firstTick;
+            int64_t x = startX;
+            int64_t y = startY;
+            startX = block(t.first).x;
+            startY = block(t.first).y;
+            for (uint32_t b = t.first; b != NONE; b = block(b).next) {
+                const Block& current = block(b);
+                putVarint(out, current.count);
+                putVarint(out, zigzag(current.x - x));
+                putVarint(out, zigzag(current.y - y));
+                x = current.x;
+                y = current.y;
+                out.write(reinterpret_cast<const char*>(current.codes), current.count / 2);
+            }
+        }
+    }
+    // adds the tracks written by write(); false if the stream ends early or is not one
+    bool read(std::istream& in) {
+        uint64_t numTracks;
+        if (!getVarint(in, numTracks)) return false;
+        int64_t startTick = 0;
+        int64_t startX = 0;
+        int64_t startY = 0;
+        for (uint64_t i = 0; i < numTracks; i++) {
+            uint64_t tickStep, trackLength, trackBlocks;
+            if (!getVarint(in, tickStep) || !getVarint(in, trackLength) || !getVarint(in, trackBlocks) || trackBlocks == 0) return false;
+            startTick += unzigzag(tickStep);
+            Track t = {static_cast<int32_t>(startTick), static_cast<int32_t>(trackLength), NONE, NONE, 0, 0};
+            int64_t x = startX;
+            int64_t y = startY;
+            uint64_t ticks = 0;
+            for (uint64_t j = 0; j < trackBlocks; j++) {
+                uint64_t count, stepX, stepY;
+                if (!getVarint(in, count) || !getVarint(in, stepX) || !getVarint(in, stepY)) return false;
+                if (count < 1 || count > BLOCK_TICKS) return false;
+                ticks += count;
+                x += unzigzag(stepX);
+                y += unzigzag(stepY);
+                uint32_t b = newBlock(static_cast<int>(x), static_cast<int>(y));
+                block(b).count = static_cast<uint8_t>(count);
+                if (!in.read(reinterpret_cast<char*>(block(b).codes), static_cast<std::streamsize>(count / 2))) return false;
+                if (t.first == NONE) {
+                    t.first = b;
+                    startX = x;
+                    startY = y;
+                } else {
+                    block(t.last).next = b;
+                }
+                t.last = b;
+            }
+            if (ticks != trackLength) return false;
+            tracks.push_back(t);
+            positionAt(tracks.size() - 1, t.firstTick + t.length - 1, tracks.back().lastX, tracks.back().lastY);
+        }
+        return true;
+    }
+};
+
+// Decides which snails get a track and feeds their positions to a store. With a
+// budget of 0 every snail is recorded. Otherwise each snail is offered once, the
+// first time it is seen, with probability rate, and algorithm R keeps a uniform
+// sample of budget of the snails offered so far: the n-th takes a slot with
+// probability budget / n, evicting the snail in it. Snails born late are as likely
+// to be kept as the first ones, and memory stays that of budget tracks.
+// Owner is whatever lets the caller find a snail again to mark it evicted.
+template <typename Owner>
+class TrajectoryRecorder {
+public:
+    static constexpr int32_t UNSEEN = -1;  // track of a snail not seen yet
+    static constexpr int32_t SKIPPED = -2; // track of a snail not in the sample
+
+private:
+    TrajectoryStore store;
+    std::vector<Owner> owners; // the snail in each slot, only kept when sampling
+    size_t budget;
+    double rate;
+    uint64_t offered = 0;
+    StreamRng rng;
+
+public:
+    TrajectoryRecorder(size_t pBudget = 0, double pRate = 1.0, uint64_t seed = 0)
+        : budget(pBudget), rate(pRate), rng(seed, 0x7472616aULL) {}
+
+    // Called every tick for every live snail with its track; returns the track to keep.
+    // evict(owner) is called for a snail that has just lost its slot.
+    template <typename Evict>
+    int32_t record(int32_t track, const Owner& owner, int tick, int x, int y, Evict evict) {
+        if (track >= 0) {
+            store.append(static_cast<uint32_t>(track), x, y);
+            return track;
+        }
+        if (track == SKIPPED) return SKIPPED;
+        if (budget == 0) return static_cast<int32_t>(store.start(tick, x, y));
+        if (rate < 1.0 && rng.unit() >= rate) return SKIPPED;
+        offered++;
+        if (store.size() < budget) {
+            owners.push_back(owner);
+            return static_cast<int32_t>(store.start(tick, x, y));
+        }
+        uint64_t slot = static_cast<uint64_t>(rng.unit() * static_cast<double>(offered));
+        if (slot >= budget) return SKIPPED;
+        evict(owners[slot]);
+        owners[slot] = owner;
+        store.restart(static_cast<uint32_t>(slot), tick, x, y);
+        return static_cast<int32_t>(slot);
+    }
+
+    bool sampling() const { return budget > 0; }
+    // for callers whose snails move, e.g. rows on compaction
+    void setOwner(int32_t track, const Owner& owner) { owners[static_cast<size_t>(track)] = owner; }
+    void setAllOwners(const Owner& owner) { owners.assign(owners.size(), owner); }
+
+    TrajectoryStore& getStore() { return store; }
+    size_t bytes() const { return store.bytes() + owners.capacity() * sizeof(Owner); }
+};
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef WINDOWAGGREGATOR_H
+#define WINDOWAGGREGATOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Min, max, mean and last of several series over windows of ticks, fed one tick at a
+// time. Windows are length ticks long and one closes every step ticks: step == length
+// gives tumbling windows, a smaller step sliding ones that overlap. Tumbling windows
+// keep running totals that are reset on close. Sliding windows keep the last length
+// values of each series in a ring, and monotonic queues of tick numbers that have the
+// min and max at the front. Every tick is O(1) per series, amortized for the queues,
+// and memory never depends on how many ticks there are.
+class WindowAggregator {
+public:
+    struct Stats {
+        int64_t min;
+        int64_t max;
+        double mean;
+        int64_t last;
+    };
+
+private:
+    // queue of tick numbers whose values only get worse towards the back, in a ring of
+    // the window's length since nothing older than the window is kept
+    struct MonotonicQueue {
+        size_t head = 0;
+        size_t size = 0;
+    };
+
+    size_t numSeries;
+    int length;
+    int step;
+    long long ticks = 0;        // fed so far
+    long long sinceClose = 0;   // fed since the last window closed
+    int firstTick = 0;          // of the current window
+    int lastTick = 0;
+    std::vector<int> tickRing;  // tick of each of the last length values, sliding only
+    std::vector<int64_t> values; // numSeries rings of length values, sliding only
+    std::vector<long long> minQueue; // numSeries rings of tick numbers
+    std::vector<long long> maxQueue;
+    std::vector<MonotonicQueue> mins;
+    std::vector<MonotonicQueue> maxes;
+    std::vector<int64_t> sums;
+    std::vector<Stats> stats;   // of the window that closed last
+    int closedFirst = 0;
+    int closedLast = 0;
+    long long closedTicks = 0;
+
+    bool sliding() const { return step < length; }
+    size_t slot(long long n) const { return static_cast<size_t>(n % length); }
+    int64_t value(size_t series, long long n) const { return values[series * length + slot(n)]; }
+
+    template <typename Worse>
+    void push(std::vector<long long>& ring, MonotonicQueue& queue, size_t series, long long n, Worse worse) {
+        long long* items = ring.data() + series * length;
+        if (queue.size > 0 && items[queue.head] <= n - length) { // fell out of the window
+            queue.head = (queue.head + 1) % length;
+            queue.size--;
+        }
+        while (queue.size > 0 && worse(value(series, items[(queue.head + queue.size - 1) % length]), value(series, n))) {
+            queue.size--;
+        }
+        items[(queue.head + queue.size) % length] = n;
+        queue.size++;
+    }
+
+    void close() {
+        long long inWindow = sliding() ? std::min<long long>(ticks, length) : sinceClose;
+        for (size_t s = 0; s < numSeries; s++) {
+            Stats& window = stats[s];
+            if (sliding()) {
+                window.min = value(s, minQueue[s * length + mins[s].head]);
+                window.max = value(s, maxQueue[s * length + maxes[s].head]);
+                window.last = value(s, ticks - 1);
+            }
+            window.mean = static_cast<double>(sums[s]) / static_cast<double>(inWindow);
+        }
+        closedFirst = sliding() ? tickRing[slot(ticks - inWindow)] : firstTick;
+        closedLast = lastTick;
+        closedTicks = inWindow;
+        sinceClose = 0;
+        if (!sliding()) {
+            std::fill(sums.begin(), sums.end(), 0);
+        }
+    }
+
+public:
+    WindowAggregator(size_t pNumSeries, int pLength, int pStep)
+        : numSeries(pNumSeries), length(pLength), step(pStep), mins(pNumSeries), maxes(pNumSeries), sums(pNumSeries, 0), stats(pNumSeries) {
+        if (length <= 0 || step <= 0 || step > length) {
+            throw std::runtime_error("Windows need 0 < step <= length");
+        }
+        if (sliding()) {
+            tickRing.resize(length);
+            values.resize(numSeries * length);
+            minQueue.resize(numSeries * length);
+            maxQueue.resize(numSeries * length);
+        }
+    }
+
+    // the values of the next tick, one per series; true when a window closed with it
+    bool add(int tick, const int64_t* tickValues) {
+        if (sinceClose == 0) firstTick = tick;
+        lastTick = tick;
+        long long n = ticks++;
+        sinceClose++;
+        for (size_t s = 0; s < numSeries; s++) {
+            int64_t v = tickValues[s];
+            Stats& window = stats[s];
+            if (sliding()) {
+                if (n >= length) sums[s] -= value(s, n);
+                values[s * length + slot(n)] = v;
+                push(minQueue, mins[s], s, n, [](int64_t back, int64_t v) { return back >= v; });
+                push(maxQueue, maxes[s], s, n, [](int64_t back, int64_t v) { return back <= v; });
+            } else if (sinceClose == 1) {
+                window.min = v;
+                window.max = v;
+            } else {
+                window.min = std::min(window.min, v);
+                window.max = std::max(window.max, v);
+            }
+            window.last = v;
+            sums[s] += v;
+        }
+        if (sliding()) {
+            tickRing[slot(n)] = tick;
+            if (ticks < length || sinceClose < step) return false;
+        } else if (sinceClose < length) {
+            return false;
+        }
+        close();
+        return true;
+    }
+    // closes a window at the last tick fed, if any came since the last one closed: a
+    // shorter tumbling window, or a sliding one over the last length ticks
+    bool flush() {
+        if (sinceClose == 0) return false;
+        close();
+        return true;
+    }
+
+    // the window that closed last
+    int windowFirstTick() const { return closedFirst; }
+    int windowLastTick() const { return closedLast; }
+    long long windowTicks() const { return closedTicks; }
+    const Stats& windowStats(size_t series) const { return stats[series]; }
+    size_t size() const { return numSeries; }
+
+    size_t bytes() const {
+        return tickRing.capacity() * sizeof(int) + values.capacity() * sizeof(int64_t) +
+               (minQueue.capacity() + maxQueue.capacity()) * sizeof(long long) +
+               (mins.capacity() + maxes.capacity()) * sizeof(MonotonicQueue) + sums.capacity() * sizeof(int64_t) +
+               stats.capacity() * sizeof(Stats);
+    }
+};
+
+#endif
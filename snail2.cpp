@@ -1,16 +1,54 @@
 #include "BaseSimulation.h" // for base classes
+#include "MemoryAccounting.h" // for per subsystem memory figures
+#include "TimingWheel.h"     // for lifecycle events
+#include "SparseOccupancy.h" // for tracking where the snails are
+#include "RegionIndex.h"     // for region lookups
+#include "SkipSampler.h"     // for rare event trials
+#include "Random.h"          // for the random generators
+#include "ThreadPool.h"      // for the parallel snail phase
+#include "JobQueue.h"        // for sweeps through a shared directory
+#include "ArrowWriter.h"     // for Arrow output
+#include "TrajectoryCodec.h" // for compressed snail trajectories
+#include "AsyncWriter.h"     // for output off the simulation thread
+#include "WindowAggregator.h" // for windowed summaries of the series
+#include "DensityHeatmap.h"  // for where the snails spend their time
+#include "MappedFile.h"      // for population snapshots
+#include "LiveMetrics.h"     // for live counters while sweeping
 #include <algorithm>  // for std::shuffle, std::sort
-#include <cstdlib>    // for rand, RAND_MAX
+#include <chrono>     // for throughput timing
+#include <cmath>      // for std::sqrt, std::floor
+#include <cstdint>    // for fixed width columns
+#include <cstdlib>    // for std::abs
+#include <cstring>    // for std::memcmp
 #include <ctime>      // for time
 #include <fstream>    // for file I/O
+#include <functional> // for std::greater
 #include "json.hpp"   // for JSON
 #include <iostream>   // for console output
+#include <limits>     // for std::numeric_limits
+#include <memory>     // for std::unique_ptr
+#include <random>     // for the cohort engine's binomial draws
+#include <sstream>    // for queue records
+#ifdef SNAILSIM_MPI
+#include <mpi.h>      // for the distributed sweep
+#endif
 #include <stdexcept>  // for exceptions
 #include <string>     // for std::string
+#include <unistd.h>   // for gethostname, getpid
 #include <vector>     // for std::vector
 
 using json = nlohmann::json;
 
+// one generator for everything that runs serially, seeded in main
+Xoshiro256 globalRng;
+// what the sweep is doing, for the metrics publisher to read at any time
+LiveMetrics liveMetrics;
+
+// uniform in (0, 1), for the skip samplers
+inline double uniformUnit() {
+    return globalRng.unit();
+}
+
 struct Point {
     int x;
     int y;
@@ -18,11 +56,6 @@ struct Point {
     // Inline constructor definition, added because of errors with construction
     Point(int x = 0, int y = 0) : x(x), y(y) {}
 };
-struct taggedPoint{
-    std::string nameTag;
-    int timeTag;
-    Point point;
-};
 
 // snailData for CSV output
 struct RegionData{
@@ -36,26 +69,141 @@ struct RegionsData{
     std::vector<RegionData> regions;
 };
 
+// What a run keeps of its per tick data, handed over by the engine every tick. The
+// peak and snail-ticks are kept up as the ticks come and windows are summarized as
+// they close, so memory does not grow with the run; the whole series is only kept
+// when it is going to be written out. Engines with snail positions also hand those
+// over when a heatmap is wanted.
+class RunRecorder {
+public:
+    using WindowSink = std::function<void(const WindowAggregator&)>;
+    using HeatmapSink = std::function<void(const DensityHeatmap&)>;
+
+private:
+    bool keepSeries;
+    int windowTicks = 0; // 0 without windows
+    int windowStep = 0;
+    WindowSink sink;
+    std::unique_ptr<WindowAggregator> windows; // made by the first tick, which knows the regions
+    int heatmapCell = 0; // 0 without heatmaps
+    int heatmapTicks = 0;
+    HeatmapSink heatmapSink;
+    std::unique_ptr<DensityHeatmap> heatmap; // made by the first positions, which know the swamp
+    std::vector<int64_t> tickValues;           // total, then food and snails of each region
+    std::vector<RegionsData> series;
+    size_t seriesHeapBytes = 0;
+    int peakPop = 0;
+    int peakTime = 0;
+    int extinctionTick = -1; // first tick without a live snail
+    long long snailTicks = 0;
+    bool started = false;
+
+public:
+    explicit RunRecorder(bool pKeepSeries = false) : keepSeries(pKeepSeries) {}
+
+    // windows of ticks ticks every step ticks, handed to sink as they close
+    void setWindows(int ticks, int step, WindowSink pSink) {
+        windowTicks = ticks;
+        windowStep = step;
+        sink = std::move(pSink);
+    }
+    // heatmaps of cellSize cells over windows of ticks ticks (0 for the whole run)
+    void setHeatmaps(int cellSize, int ticks, HeatmapSink pSink) {
+        heatmapCell = cellSize;
+        heatmapTicks = ticks;
+        heatmapSink = std::move(pSink);
+    }
+    bool wantsPositions() const { return heatmapCell > 0; }
+    // the positions at the end of a tick; live is 0 for rows to skip, or null
+    void addPositions(int tick, const IndexRect& swampBounds, const int* xs, const int* ys, const uint8_t* live, size_t n) {
+        if (!heatmap) {
+            heatmap.reset(new DensityHeatmap(swampBounds.minX, swampBounds.minY, swampBounds.maxX, swampBounds.maxY, heatmapCell, heatmapTicks));
+        }
+        if (heatmap->addTick(tick, xs, ys, live, n)) heatmapSink(*heatmap);
+    }
+
+    void add(RegionsData entry) {
+        if (!started || entry.totalPop > peakPop) { // the first tick of the highest peak
+            peakPop = entry.totalPop;
+            peakTime = entry.time;
+            started = true;
+        }
+        snailTicks += entry.totalPop;
+        liveMetrics.addTick(entry.totalPop);
+        if (entry.totalPop == 0 && extinctionTick < 0) {
+            extinctionTick = entry.time;
+        }
+        if (windowTicks > 0) {
+            if (!windows) {
+                windows.reset(new WindowAggregator(1 + 2 * entry.regions.size(), windowTicks, windowStep));
+                tickValues.resize(windows->size());
+            }
+            tickValues[0] = entry.totalPop;
+            for (size_t r = 0; r < entry.regions.size(); r++) {
+                tickValues[1 + 2 * r] = entry.regions[r].foodLevel;
+                tickValues[2 + 2 * r] = entry.regions[r].numOfSnails;
+            }
+            if (windows->add(entry.time, tickValues.data()) && sink) sink(*windows);
+        }
+        if (keepSeries) {
+            seriesHeapBytes += vectorBytes(entry.regions);
+            series.push_back(std::move(entry));
+        }
+    }
+    // closes the last windows, after the last tick
+    void finish() {
+        if (windows && windows->flush() && sink) sink(*windows);
+        if (heatmap && heatmap->flush()) heatmapSink(*heatmap);
+    }
+
+    int getPeakPop() const { return peakPop; }
+    int getPeakTime() const { return peakTime; }
+    long long getSnailTicks() const { return snailTicks; }
+    int getExtinctionTick() const { return extinctionTick; }
+    std::vector<RegionsData>& getSeries() { return series; }
+    size_t bytes() const {
+        return vectorBytes(series) + seriesHeapBytes + vectorBytes(tickValues) + (windows ? sizeof(WindowAggregator) + windows->bytes() : 0) +
+               (heatmap ? sizeof(DensityHeatmap) + heatmap->bytes() : 0);
+    }
+};
+
 class Region: public SimulationObject {
     private:
-        int halfLength;
-        Point centerPoint;
+        IndexRect bounds; // cells the region covers, inclusive
         int foodGrowth;
         int regionFood;
         int maxFood; 
+        int lastTick = -1; // regionFood includes the growth of every tick up to this one
+
+        // growth is applied in closed form when the food is looked at, so a region
+        // nobody visits costs nothing; min(food + k*growth, max) is k single steps
+        void catchUp(int tick){
+            if (tick <= lastTick) return;
+            long long grown = regionFood + static_cast<long long>(foodGrowth) * (tick - lastTick);
+            regionFood = static_cast<int>(std::min<long long>(grown, maxFood));
+            lastTick = tick;
+        }
+        // share of a swamp wide amount, rounded down like the old whole percentages
+        static int shareOf(int amount, double share){
+            return static_cast<int>(std::floor(amount * share + 1e-6));
+        }
 
     public:
-        Region(std::string name, int pPredProb, int phalfLength,Point pCenterPoint, int pFoodPercentage,int pTotalFood, int pFoodGrowth, int pMaxFood):
-        SimulationObject(name),halfLength(phalfLength), centerPoint(pCenterPoint),regionFood((pTotalFood * pFoodPercentage)/100), foodGrowth((pFoodGrowth*pFoodPercentage)/100), maxFood((pMaxFood*pFoodPercentage)/100){}
+        Region(std::string name, int pPredProb, IndexRect pBounds, double pFoodShare, int pTotalFood, int pFoodGrowth, int pMaxFood):
+        SimulationObject(name), bounds(pBounds), foodGrowth(shareOf(pFoodGrowth, pFoodShare)), regionFood(shareOf(pTotalFood, pFoodShare)), maxFood(shareOf(pMaxFood, pFoodShare)){}
 
-        Point getRegionPos(){return centerPoint;};
-        int getRegionhalfLength(){return halfLength;}
-        int getFoodLevel(){return regionFood;};
+        const IndexRect& getBounds() const {return bounds;}
+        Point getRegionPos(){return Point((bounds.minX + bounds.maxX) / 2, (bounds.minY + bounds.maxY) / 2);};
+        int getRegionhalfWidth(){return (bounds.maxX - bounds.minX) / 2;}
+        int getRegionhalfLength(){return (bounds.maxY - bounds.minY) / 2;}
+        int getFoodLevel(int tick){
+            catchUp(tick);
+            return regionFood;
+        };
         void collide()override{}
-        void update() override {
-            regionFood = std::min(regionFood += foodGrowth, maxFood);
-        }
-        int getFood(int foodAmount){
+        void update() override {} // food grows lazily, see catchUp
+        int getFood(int foodAmount, int tick){
+            catchUp(tick);
             if (regionFood>= foodAmount){
                 regionFood -= foodAmount;
                 return foodAmount;
@@ -90,6 +238,19 @@ protected:
     int timestepsLimit;
     bool simulationRunning;
 };
+// Age based transitions are fully determined by the birth tick, so they are
+// scheduled once at birth instead of being checked every tick
+enum class LifecycleEvent : uint8_t {
+    Mature,  // age > maturityAge from this tick on
+    AgeDeath // age > maxAge
+};
+
+class Snail;
+struct SnailEvent {
+    Snail* snail;
+    LifecycleEvent event;
+};
+
 //Swamp Class
 class Swamp: public SimulationObject {
 private:
@@ -99,36 +260,92 @@ private:
     Point midPoint = {0,0};
     Simulation* sim;
     std::vector<Region*> regions;
+    RegionIndex regionIndex; // built once the regions are set
+    int maxHalfWidth = 0;    // largest region half sizes, the furthest a predator reaches
+    int maxHalfLength = 0;
+    SwampClock* clock = nullptr;
+    TimingWheel<SnailEvent> lifecycle;
+    // snails by position, rebuilt at most once a tick when someone asks what is near
+    std::vector<Snail*> snails;
+    std::vector<int> snailX;
+    std::vector<int> snailY;
+    std::vector<uint8_t> snailIncluded;
+    SparseOccupancy snailIndex;
+    int snailIndexTick = -1;
+    SkipSampler reproduction; // shared by every snail, one trial per mature snail per tick
+
+    void rebuildSnailIndex();
 
 public:
     Swamp(const std::string& name ,int swampFoodRegen, int swampMaxFood, int swampInitialFood, Simulation* simulation, int swampWidth, int swampLength)
     : SimulationObject(name), sim(simulation),width(swampWidth),length(swampLength){}
-    void update() override {}  
+    void update() override; // fires this tick's lifecycle events, so it runs before the snails
+
+    // events are never more than maxAge + 1 ticks away
+    void setClock(SwampClock* pClock, int maxAge) {
+        clock = pClock;
+        lifecycle = TimingWheel<SnailEvent>(maxAge + 1, pClock->getTimesteps());
+    }
+    int getTimesteps() const { return clock->getTimesteps(); }
+    void scheduleEvent(int tick, Snail* snail, LifecycleEvent event) {
+        lifecycle.schedule(tick, SnailEvent{snail, event});
+    }
    
+    ~Swamp() override {
+        for (Region* region : regions) {
+            delete region;
+        }
+    }
+    Swamp(const Swamp&) = delete;
+    Swamp& operator=(const Swamp&) = delete;
+
     Region* getRegion(int i ){return regions[i];}
-    void setRegions(std::vector<Region*> pRegion){regions = pRegion;}
+    const std::vector<Region*>& getRegions() const { return regions; }
+    // the swamp owns its regions; every cell of the swamp has to be in one of them
+    void setRegions(std::vector<Region*> pRegion){
+        regions = pRegion;
+        std::vector<IndexRect> bounds;
+        for (Region* region : regions) {
+            bounds.push_back(region->getBounds());
+        }
+        regionIndex.build(bounds, IndexRect{-width, -length, width, length});
+        for (Region* region : regions) {
+            maxHalfWidth = std::max(maxHalfWidth, region->getRegionhalfWidth());
+            maxHalfLength = std::max(maxHalfLength, region->getRegionhalfLength());
+        }
+        int x, y;
+        if (regionIndex.findUncovered(x, y)) {
+            throw std::runtime_error("Region layout leaves cell (" + std::to_string(x) + ", " + std::to_string(y) + ") outside every region");
+        }
+    }
+    IndexRect getSwampBounds() const { return IndexRect{-width, -length, width, length}; }
+    int getMaxHalfWidth() const { return maxHalfWidth; }
+    int getMaxHalfLength() const { return maxHalfLength; }
+    size_t indexBytes() const {
+        return regionIndex.bytes() + snailIndex.bytes() + vectorBytes(snails) + vectorBytes(snailX) + vectorBytes(snailY) + vectorBytes(snailIncluded);
+    }
+    void setIndexTileSize(int tileSize) { snailIndex = SparseOccupancy(tileSize); }
+    void setReproProb(int reproProb) { reproduction.setProb(1.0 / reproProb); }
+    bool reproductionTrial() { return reproduction.trial(uniformUnit); }
+    // every snail registers itself, so spatial queries do not have to scan the simulation
+    void trackSnail(Snail* snail) { snails.push_back(snail); }
+    // calls visit(snail) for the live snails that may be in the rectangle, as of the
+    // start of this tick's queries; the caller checks exact positions
+    template <typename Visitor>
+    void forEachSnailNear(int minX, int minY, int maxX, int maxY, Visitor visit);
 
     void collide()override{}
 
-    int checkRegion(Point posToCheck, Region*  regionToCheck){
-        int halfLength = regionToCheck->getRegionhalfLength();
-        Point centerPoint = regionToCheck->getRegionPos();
-        if ((std::abs(posToCheck.x-centerPoint.x)<=halfLength) && (std::abs(posToCheck.y-centerPoint.y)<=halfLength)){ // regions are squares; width == length 
-            return 1;
-        }
-        return 0;
+    // region of every cell of the rectangle (clipped to the swamp), or -1 if they differ
+    int getRectRegion(int minX, int minY, int maxX, int maxY){
+        return regionIndex.findRect(IndexRect{minX, minY, maxX, maxY});
     }
+    // first region holding pos
     int getRegionInt(Point pos){
-        int i = 0;
-        for (Region* region : regions) {
-            if (checkRegion(pos, region) == 1){
-                return i;
-            }
-            i+=1;
-        } 
-        return -1; // invalid result of -1 to cause error     
-    
+        return regionIndex.find(pos.x, pos.y); // invalid result of -1 to cause error
     }
+    // cells of the swamp that getRegionInt puts in each region
+    std::vector<long long> getRegionCells() const { return regionIndex.cellCounts(); }
     void addSnail(SimulationObject* SimObj){
         sim->addObject(SimObj);
     }
@@ -153,8 +370,9 @@ public:
 class Snail : public SimulationObject {
 private:
     std::string name;
-    int age;
+    int birthTick; // age is derived from it, the lifecycle wheel handles maturity and old age
     bool isAlive;
+    bool isMature = false;
     int reproProb;
     int predProb;
     int maturityAge;
@@ -162,30 +380,52 @@ private:
     int minOffspring;
     int maxOffspring;
     int daysStarved = 0;
-    int mealSize = age*0.1; // intialize mealSize in accordance to age
+    int mealSize = 0;
     int healthIndex = 3;
     bool eatenStatus = false;
     Point pos;
     Swamp& swamp;
     int regionInt;
     Region* region;
+    int track = -1; // the collector's trajectory of this snail, -1 until it is seen, -2 if not sampled
 
 public:
-    Snail(const std::string pName, int Age,int snailReproProb, int snailPredProb, int snailMaturityAge, int snailMaxAge, int snailMinOffspring,int snailMaxOffspring,Point Position,Swamp& swamp)
-        : SimulationObject(name), name(pName),age(Age), isAlive(true), reproProb(snailReproProb),predProb(snailPredProb), maturityAge(snailMaturityAge), maxAge(snailMaxAge), minOffspring(snailMinOffspring),maxOffspring(snailMaxOffspring),pos(Position),swamp(swamp){}
+    // a snail is age a at tick t when t - birthTick == a, counting the update that ages it
+    Snail(const std::string pName, int BirthTick,int snailReproProb, int snailPredProb, int snailMaturityAge, int snailMaxAge, int snailMinOffspring,int snailMaxOffspring,Point Position,Swamp& swamp)
+        : SimulationObject(pName), name(pName),birthTick(BirthTick), isAlive(true), reproProb(snailReproProb),predProb(snailPredProb), maturityAge(snailMaturityAge), maxAge(snailMaxAge), minOffspring(snailMinOffspring),maxOffspring(snailMaxOffspring),pos(Position),swamp(swamp),
+          regionInt(swamp.getRegionInt(Position)), region(swamp.getRegion(regionInt)){ // region set up front so the collector can count newborns
+        int matureTick = birthTick + maturityAge + 1;
+        if (matureTick < swamp.getTimesteps()) {
+            isMature = true;
+        } else if (maturityAge < maxAge) { // otherwise age death comes first, and is as far as the wheel reaches
+            swamp.scheduleEvent(matureTick, this, LifecycleEvent::Mature);
+        }
+        swamp.scheduleEvent(birthTick + maxAge + 1, this, LifecycleEvent::AgeDeath);
+        swamp.trackSnail(this);
+    }
 
+    void handleEvent(LifecycleEvent event) {
+        if (event == LifecycleEvent::Mature) {
+            isMature = true;
+        } else {
+            isAlive = false;
+        }
+    }
     bool getAliveStatus() const { return isAlive;};
     int getRegionNum () {return regionInt;};
     void setEatenStatus(bool status){eatenStatus = status;}
     Point getPos(){return pos;};
     const std::string& getName(){return name;};
+    int getTrack() const { return track; }
+    void setTrack(int pTrack) { track = pTrack; }
     void collide()override{}
     void reproduce() {
-            int numOffspring = minOffspring + (rand() % ((healthIndex*maxOffspring) - (healthIndex*minOffspring) + 1));
+            int numOffspring = minOffspring + static_cast<int>(globalRng.below(static_cast<uint32_t>((healthIndex*maxOffspring) - (healthIndex*minOffspring) + 1)));
+            std::string prefix = name + " o"; // built once per litter
             for (int i = 0; i < numOffspring; i++) {
-                std::string newName = name + " o" + std::to_string(i);
+                std::string newName = prefix + std::to_string(i);
                 Snail* offspring = new Snail(
-                    newName, 0,reproProb, predProb, maturityAge, maxAge,
+                    newName, swamp.getTimesteps(),reproProb, predProb, maturityAge, maxAge,
                     minOffspring, maxOffspring, pos, swamp
                 );
                 swamp.addSnail(offspring);
@@ -202,14 +442,10 @@ public:
             return;
         }
         move();
-        age++;
+        int age = swamp.getTimesteps() - birthTick;
         int tMealhalfLength = (age*0.1);
         mealSize = std::min(20,tMealhalfLength);
-        if (age > maxAge){
-            isAlive = false;
-            return;
-        }
-        int foodAmount = region->getFood(mealSize);
+        int foodAmount = region->getFood(mealSize, swamp.getTimesteps());
         if (foodAmount == 0) {
                 daysStarved += 1;
                 healthIndex = std::max(healthIndex-1,1); 
@@ -231,51 +467,84 @@ public:
             isAlive = false; 
             return;
         }
-        int rNum = (rand() % reproProb);
-        if (age > maturityAge && rNum == 0) {
+        if (isMature && swamp.reproductionTrial()) {
             reproduce();
         }
     }
     void move() { //move randomly and then check for boundaries 
-        pos.x += (rand() % 3) - 1;
-        pos.y += (rand() % 3) - 1;
+        pos.x += static_cast<int>(globalRng.below(3)) - 1;
+        pos.y += static_cast<int>(globalRng.below(3)) - 1;
         pos = swamp.checkPos(pos);
     }
 };
+
+inline void Swamp::update() {
+    lifecycle.fire(clock->getTimesteps(), [](const SnailEvent& e) {
+        e.snail->handleEvent(e.event);
+    });
+}
+// dead snails are dropped from the list here, the simulation still owns them
+inline void Swamp::rebuildSnailIndex() {
+    size_t kept = 0;
+    for (Snail* snail : snails) {
+        if (snail->getAliveStatus()) snails[kept++] = snail;
+    }
+    snails.resize(kept);
+    snailX.resize(kept);
+    snailY.resize(kept);
+    snailIncluded.assign(kept, 1);
+    for (size_t i = 0; i < kept; i++) {
+        Point pos = snails[i]->getPos();
+        snailX[i] = pos.x;
+        snailY[i] = pos.y;
+    }
+    snailIndex.rebuild(snailX.data(), snailY.data(), snailIncluded.data(), snailX.size());
+    snailIndexTick = getTimesteps();
+}
+
+template <typename Visitor>
+void Swamp::forEachSnailNear(int minX, int minY, int maxX, int maxY, Visitor visit) {
+    if (snailIndexTick != getTimesteps()) {
+        rebuildSnailIndex();
+    }
+    snailIndex.forEachTileInRect(minX, minY, maxX, maxY, [&](const uint32_t* rows, size_t count) {
+        for (size_t k = 0; k < count; k++) {
+            Snail* snail = snails[rows[k]];
+            if (snail->getAliveStatus()) visit(snail);
+        }
+    });
+}
+
+// Predators are added ahead of the snails, so they see where the snails ended the
+// last tick and a marked snail dies on its own update, after it has eaten
 class Predator : public SimulationObject{
     private:
         std::string name;
         int predProb;
         Point positon;
         int maxAge;
-        Simulation* sim;
         Swamp* swamp;
         bool hungryStatus = false;
+        SkipSampler hunt; // one trial per snail in reach
     public:
-    Predator(std::string pName, int pPredProb, Point pPosition, int pMaxAge, Simulation* pSim, Swamp* pSwamp)
-        : SimulationObject(name), predProb(pPredProb), positon(pPosition), maxAge(pMaxAge), sim(pSim),swamp(pSwamp){}
+    Predator(std::string pName, int pPredProb, Point pPosition, int pMaxAge, Swamp* pSwamp)
+        : SimulationObject(pName), name(pName), predProb(pPredProb), positon(pPosition), maxAge(pMaxAge), swamp(pSwamp), hunt(1.0 / pPredProb){}
     void collide()override{}
     void update()override{
-        std::vector<SimulationObject*> simObjects = sim->getObjects();
-        for (SimulationObject* obj : simObjects){
-            if (Snail* snail = dynamic_cast<Snail*>(obj)) {
-                bool isAlive = snail->getAliveStatus();
-                    if (isAlive){ // check if obj is a snail and is alive
-                        Point snailPos = snail->getPos();
-                        int regionNum = swamp->getRegionInt(snailPos);
-                        Region* region = swamp->getRegion(regionNum);
-                        int halfLength = region->getRegionhalfLength();
-                        if ((std::abs(snailPos.x-positon.x)<=halfLength) && (std::abs(snailPos.y-positon.y)<=halfLength)){ // check if snail is within same region as Pred
-                            int num = (rand() % predProb);
-                            if (num == 0){
-                                snail->setEatenStatus(true);
-                                hungryStatus = true;
-
-                        }
-                    }
+        // a predator reaches as far as the half sizes of the snail's region, so only
+        // snails within the largest of those need looking at
+        int reachX = swamp->getMaxHalfWidth();
+        int reachY = swamp->getMaxHalfLength();
+        swamp->forEachSnailNear(positon.x - reachX, positon.y - reachY, positon.x + reachX, positon.y + reachY, [this](Snail* snail) {
+            Point snailPos = snail->getPos();
+            Region* region = swamp->getRegion(swamp->getRegionInt(snailPos));
+            if ((std::abs(snailPos.x-positon.x)<=region->getRegionhalfWidth()) && (std::abs(snailPos.y-positon.y)<=region->getRegionhalfLength())){ // check if snail is within same region as Pred
+                if (hunt.trial(uniformUnit)){
+                    snail->setEatenStatus(true);
+                    hungryStatus = true;
                 }
             }
-        }
+        });
     }
 };     
 class DataCollector : public SimulationObject{
@@ -284,37 +553,57 @@ class DataCollector : public SimulationObject{
         Swamp* swamp;
         SwampClock* clock;
         Simulation* world;
-        std::vector<taggedPoint> snailPositons;
+        TrajectoryRecorder<Snail*> trajectories;
+        bool recordTrajectories = false;
+        MemoryLedger* ledger = nullptr;
+        RunRecorder* recorder = nullptr;
+        std::vector<int> liveX; // this tick's positions, for the heatmap
+        std::vector<int> liveY;
     public:
-        DataCollector(const std::string& name, SwampClock* Clock, Simulation* sim)
-        : SimulationObject(name),clock(Clock), world(sim){}
+        DataCollector(const std::string& name, SwampClock* Clock, Simulation* sim, Swamp* pSwamp)
+        : SimulationObject(name),swamp(pSwamp),clock(Clock), world(sim){}
+        void setLedger(MemoryLedger* pLedger){ ledger = pLedger; }
+        void setRecorder(RunRecorder* pRecorder){ recorder = pRecorder; }
+        // budget 0 records every snail, otherwise a sample of that many
+        void setRecordTrajectories(size_t budget, double rate, uint64_t seed){
+            recordTrajectories = true;
+            trajectories = TrajectoryRecorder<Snail*>(budget, rate, seed);
+        }
 
-        std::vector<RegionsData> outputData;
         void collide()override{}
         void update()override {
             RegionsData newEntry = RegionsData{};
             int timestep = clock->getTimesteps();
             newEntry.time = timestep;
             std::vector<SimulationObject*> simObjects = world->getObjects();
+            size_t populationBytes = world->getObjectCapacity() * sizeof(SimulationObject*);
+            const std::vector<Region*>& regions = swamp->getRegions();
+            size_t numRegions = regions.size();
+            for (Region* region : regions) {
+                int foodLevel = (region->getFoodLevel(timestep));
+                RegionData regionData = {foodLevel,0};
+                newEntry.regions.push_back(regionData);
+            }
+            bool positions = recorder && recorder->wantsPositions();
+            liveX.clear();
+            liveY.clear();
             for (SimulationObject* obj : simObjects) {
-                if (Region* region = dynamic_cast<Region*>(obj)) {
-                    int foodLevel = (region->getFoodLevel());
-                    RegionData regionData = {foodLevel,0};
-                    newEntry.regions.push_back(regionData);
-                    
-                }
-
-                else if (Snail* snail = dynamic_cast<Snail*>(obj)) {
+                if (Snail* snail = dynamic_cast<Snail*>(obj)) {
+                    populationBytes += sizeof(Snail) + 2 * stringBytes(snail->getName()); // own name plus the base class copy
                     bool isAlive = snail->getAliveStatus();
                     if (isAlive){
                         int regionNum = snail->getRegionNum();
                         newEntry.regions[regionNum].numOfSnails +=1;
                         newEntry.totalPop += 1;
-                        Point pos = snail->getPos();
-                        std::string snailName = snail->getName();
-                        taggedPoint snailPos = {snailName, timestep, pos};
-                        snailPositons.push_back(snailPos);
-
+                        if (positions) {
+                            liveX.push_back(snail->getPos().x);
+                            liveY.push_back(snail->getPos().y);
+                        }
+                        if (recordTrajectories) {
+                            Point pos = snail->getPos();
+                            snail->setTrack(trajectories.record(snail->getTrack(), snail, timestep, pos.x, pos.y,
+                                                                [](Snail* evicted) { evicted->setTrack(TrajectoryRecorder<Snail*>::SKIPPED); }));
+                        }
                     }
 
                 }
@@ -323,33 +612,265 @@ class DataCollector : public SimulationObject{
             
             }
 
-            outputData.push_back(newEntry);
+            if (recorder) recorder->add(std::move(newEntry));
+            if (positions) {
+                recorder->addPositions(timestep, swamp->getSwampBounds(), liveX.data(), liveY.data(), nullptr, liveX.size());
+            }
+            if (ledger) {
+                ledger->set(MemoryCategory::Population, populationBytes);
+                ledger->set(MemoryCategory::SpatialIndex, numRegions * (sizeof(Region) + sizeof(Region*)) + swamp->indexBytes()); // regions plus the swamp's lookup structures
+                ledger->set(MemoryCategory::CollectorHistory, (recorder ? recorder->bytes() : 0) + trajectories.bytes() + vectorBytes(liveX) + vectorBytes(liveY));
+            }
         }
-         std::vector<RegionsData>returnOutputData(){return outputData;}
-        std::vector<taggedPoint>returnPositions(){return snailPositons;}
+        TrajectoryStore& getTrajectories(){return trajectories.getStore();}
         
 };
 
+// one region of the layout, before it is built
+struct RegionSpec {
+    std::string name;
+    int predProb;
+    IndexRect bounds;
+    double foodShare; // fraction of the swamp's food, regrowth and cap
+};
+
+struct PredatorSpec {
+    std::string name;
+    Point position;
+};
+
+// swamp and snail parameters from the JSON config
+struct SwampParams {
+    int foodRegen;
+    int maxFood;
+    int initialFood;
+    int width;
+    int length;
+    int maturityAge;
+    int maxAge;
+    int minOffspring;
+    int maxOffspring;
+    int occupancyTileSize; // side of the tiles used to track where snails are
+    size_t trajectoryBudget; // snails kept when trajectories are sampled
+    double trajectoryRate;   // chance a snail is offered to the sample at all
+    std::vector<RegionSpec> regions;
+    std::vector<PredatorSpec> predators;
+};
+
+enum class TrajectoryMode {
+    None,
+    All,   // every snail's path
+    Sample // the paths of a uniform sample of the snails, sized by trajectorySample
+};
+
+// the original layout: four quadrants sharing the axes, where the first match wins
+std::vector<RegionSpec> quadrantRegions(int width, int length) {
+    return {RegionSpec{"region1", 75, IndexRect{0, -length, width, 0}, 0.3},
+            RegionSpec{"region2", 25, IndexRect{0, 0, width, length}, 0.2},
+            RegionSpec{"region3", 75, IndexRect{-width, 0, 0, length}, 0.3},
+            RegionSpec{"region4", 25, IndexRect{-width, -length, 0, 0}, 0.2}};
+}
+
+// columns x rows tiles splitting the swamp without overlap; the food pattern is
+// repeated over the tiles and scaled so the shares add up to one
+std::vector<RegionSpec> tiledRegions(int width, int length, int columns, int rows, std::vector<double> pattern) {
+    if (columns <= 0 || rows <= 0) {
+        throw std::runtime_error("Region tiling needs positive columns and rows");
+    }
+    if (columns > 2 * width + 1 || rows > 2 * length + 1) {
+        throw std::runtime_error("Region tiling has more tiles than swamp cells");
+    }
+    if (pattern.empty()) {
+        pattern.push_back(1.0);
+    }
+    double total = 0;
+    for (int i = 0; i < columns * rows; i++) {
+        total += pattern[i % pattern.size()];
+    }
+    if (total <= 0) {
+        throw std::runtime_error("Region tiling food pattern adds up to nothing");
+    }
+    // tile k starts at cell -extent + k * cells / tiles
+    auto edge = [](int extent, int tiles, int k) {
+        return -extent + static_cast<int>(static_cast<long long>(2 * extent + 1) * k / tiles);
+    };
+    std::vector<RegionSpec> regions;
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            int i = row * columns + column;
+            IndexRect bounds = {edge(width, columns, column), edge(length, rows, row),
+                                edge(width, columns, column + 1) - 1, edge(length, rows, row + 1) - 1};
+            regions.push_back(RegionSpec{"region" + std::to_string(i + 1), 0, bounds, pattern[i % pattern.size()] / total});
+        }
+    }
+    return regions;
+}
+
+// "regions" is either a list of regions, each with bounds [minX, minY, maxX, maxY] or
+// a center and half sizes, or a tiling {"columns", "rows", "food"}; without it the quadrants are used
+std::vector<RegionSpec> readRegionLayout(const json& j, int width, int length) {
+    if (!j.contains("regions")) {
+        return quadrantRegions(width, length);
+    }
+    const json& layout = j["regions"];
+    if (layout.is_object()) {
+        return tiledRegions(width, length, layout.at("columns").get<int>(), layout.at("rows").get<int>(),
+                            layout.value("food", std::vector<double>()));
+    }
+    std::vector<RegionSpec> regions;
+    for (const json& r : layout) {
+        RegionSpec spec;
+        spec.name = r.value("name", "region" + std::to_string(regions.size() + 1));
+        spec.predProb = r.value("predProb", 0);
+        spec.foodShare = r.at("food").get<double>();
+        if (r.contains("bounds")) {
+            std::vector<int> b = r["bounds"].get<std::vector<int>>();
+            if (b.size() != 4) {
+                throw std::runtime_error("Region bounds need four values: " + spec.name);
+            }
+            spec.bounds = IndexRect{b[0], b[1], b[2], b[3]};
+        } else {
+            std::vector<int> c = r.at("center").get<std::vector<int>>();
+            if (c.size() != 2) {
+                throw std::runtime_error("Region center needs two values: " + spec.name);
+            }
+            int halfLength = r.at("halfLength").get<int>();
+            int halfWidth = r.value("halfWidth", halfLength); // squares unless told otherwise
+            spec.bounds = IndexRect{c[0] - halfWidth, c[1] - halfLength, c[0] + halfWidth, c[1] + halfLength};
+        }
+        if (spec.bounds.minX > spec.bounds.maxX || spec.bounds.minY > spec.bounds.maxY) {
+            throw std::runtime_error("Region has empty bounds: " + spec.name);
+        }
+        regions.push_back(spec);
+    }
+    if (regions.empty()) {
+        throw std::runtime_error("Region layout is empty");
+    }
+    return regions;
+}
+
+// "predators" is either a list of {"name", "position": [x, y]} or {"count", "seed"}
+// for predators placed uniformly over the swamp, the same in every run; without it
+// there is the original one in the middle of the second region
+std::vector<PredatorSpec> readPredators(const json& j, int width, int length) {
+    std::vector<PredatorSpec> predators;
+    if (!j.contains("predators")) {
+        predators.push_back(PredatorSpec{"pred1", Point(width / 2, length / 2)});
+        return predators;
+    }
+    const json& layout = j["predators"];
+    if (layout.is_object()) {
+        int count = layout.at("count").get<int>();
+        if (count < 0) {
+            throw std::runtime_error("Predator count must not be negative");
+        }
+        std::mt19937 placement(layout.value("seed", 1u));
+        std::uniform_int_distribution<int> xs(-width, width);
+        std::uniform_int_distribution<int> ys(-length, length);
+        for (int i = 0; i < count; i++) {
+            int x = xs(placement);
+            predators.push_back(PredatorSpec{"pred" + std::to_string(i + 1), Point(x, ys(placement))});
+        }
+        return predators;
+    }
+    for (const json& p : layout) {
+        std::vector<int> position = p.at("position").get<std::vector<int>>();
+        if (position.size() != 2) {
+            throw std::runtime_error("Predator position needs two values");
+        }
+        predators.push_back(PredatorSpec{p.value("name", "pred" + std::to_string(predators.size() + 1)), Point(position[0], position[1])});
+    }
+    return predators;
+}
+
+// top level config values a sweep cell sets in place of the file's, by name
+using ConfigOverrides = std::vector<std::pair<std::string, int>>;
+
+json readConfigJson(const std::string& configFilePath) {
+    std::ifstream file(configFilePath);
+    if (!file.is_open()) {
+    throw std::runtime_error("Failed to open JSON file: " + configFilePath);
+    }
+    json j;
+    file >> j;
+    return j;
+}
+
+// the overrides go in before anything is read, so values that depend on them, like
+// the default region layout on the swamp's size, follow
+SwampParams parseSwampParams(json j, const ConfigOverrides& overrides = {}) {
+    for (const auto& entry : overrides) {
+        j[entry.first] = entry.second;
+    }
+    SwampParams params;
+    params.foodRegen = j["foodRegen"].get<int>();
+    params.maxFood = j["maxFood"].get<int>();
+    params.initialFood = j["initialFood"].get<int>();
+    params.width = j["swampWidth"].get<int>();
+    params.length = j["swampLength"].get<int>();
+    params.maturityAge = j["maturityAge"].get<int>();
+    params.maxAge = j["maxAge"].get<int>();
+    params.minOffspring = j["minOffspring"].get<int>();
+    params.maxOffspring = j["maxOffspring"].get<int>();
+    params.occupancyTileSize = j.value("occupancyTileSize", 16);
+    const json sample = j.value("trajectorySample", json::object());
+    params.trajectoryBudget = sample.value("snails", static_cast<size_t>(1000));
+    params.trajectoryRate = sample.value("rate", 1.0);
+    if (params.trajectoryBudget == 0 || !(params.trajectoryRate > 0.0 && params.trajectoryRate <= 1.0)) {
+        throw std::runtime_error("trajectorySample needs snails > 0 and rate in (0, 1]");
+    }
+    params.regions = readRegionLayout(j, params.width, params.length);
+    params.predators = readPredators(j, params.width, params.length);
+    return params;
+}
+
+SwampParams readSwampParams(const std::string& configFilePath, const ConfigOverrides& overrides = {}) {
+    return parseSwampParams(readConfigJson(configFilePath), overrides);
+}
+
+// the configured regions, shared by every engine; the swamp that gets them owns them
+std::vector<Region*> buildRegions(const SwampParams& params) {
+    std::vector<Region*> regions;
+    for (const RegionSpec& spec : params.regions) {
+        regions.push_back(new Region(spec.name, spec.predProb, spec.bounds, spec.foodShare, params.initialFood, params.foodRegen, params.maxFood));
+    }
+    return regions;
+}
+
+// Calls visit(i, x, y, age) for count snails placed uniformly over the swamp with a
+// uniform age below maxAge. Drawn a column at a time in chunks, so every engine places
+// its snails the same way without holding all the draws at once.
+template <typename Visitor>
+void forEachInitialSnail(long long count, const SwampParams& params, Visitor visit) {
+    const size_t CHUNK = 4096;
+    uint32_t xs[CHUNK], ys[CHUNK], ages[CHUNK];
+    for (long long first = 0; first < count; first += CHUNK) {
+        size_t n = static_cast<size_t>(std::min<long long>(CHUNK, count - first));
+        globalRng.fillBelow(xs, n, static_cast<uint32_t>(2 * params.width + 1));
+        globalRng.fillBelow(ys, n, static_cast<uint32_t>(2 * params.length + 1));
+        globalRng.fillBelow(ages, n, static_cast<uint32_t>(params.maxAge));
+        for (size_t k = 0; k < n; k++) {
+            visit(first + static_cast<long long>(k), static_cast<int>(xs[k]) - params.width, static_cast<int>(ys[k]) - params.length, static_cast<int>(ages[k]));
+        }
+    }
+}
+
 // SwampConfig Class
 class SwampConfig : public Configure {
 private:
     DataCollector* Collector;
+    Swamp* swamp = nullptr;
     std::string configFilePath;
     Simulation* simulation;
     SwampClock* clock;
     int snailCount;
     int duration;
-    int swampFoodRegen;
-    int swampMaxFood;
-    int swampInitialFood;
-    int swampWidth;
-    int swampLength;
+    SwampParams params;
     int snailReproProb;
     int snailPredProb;
-    int snailMaturityAge;
-    int snailMaxAge;
-    int snailMinOffspring;
-    int snailMaxOffspring;
+    MemoryLedger* ledger = nullptr;
+    RunRecorder* recorder = nullptr;
+    ConfigOverrides overrides;
 
     
 public:
@@ -357,196 +878,2465 @@ public:
         : Configure(nullptr), 
           configFilePath(configFilePath), snailCount(snails), duration(duration),clock(Clock), snailPredProb(pPredProb), snailReproProb(pReproProb){}
 
-    std::vector<RegionsData> data;
-    std::vector<taggedPoint> positionSummary;
+    TrajectoryStore trajectories;
+    TrajectoryMode trajectoryMode = TrajectoryMode::None;
 
     void readJson() {
-        std::ifstream file(configFilePath);
-        if (!file.is_open()) {
-        throw std::runtime_error("Failed to open JSON file: " + configFilePath);
-        }
-        json j;
-        file >> j;
-        swampFoodRegen = j["foodRegen"].get<int>();
-        swampMaxFood = j["maxFood"].get<int>();
-        swampInitialFood = j["initialFood"].get<int>();
-        swampWidth = j["swampWidth"].get<int>();
-        swampLength = j["swampLength"].get<int>();
-        snailMaturityAge = j["maturityAge"].get<int>();
-        snailMaxAge = j["maxAge"].get<int>();
-        snailMinOffspring = j["minOffspring"].get<int>();
-        snailMaxOffspring = j["maxOffspring"].get<int>();
-        
+        params = readSwampParams(configFilePath, overrides);
     };
     
     
     void configure() override {
         readJson();
-        Swamp* swamp = new Swamp("Swamp", swampFoodRegen, swampMaxFood, swampInitialFood, simulation, swampWidth, swampLength);
-        
-        Point centerPoint = Point(125,-125);
-        Region* region1 = new Region("region1",75,125,centerPoint,30,swampInitialFood,swampFoodRegen,swampMaxFood); // name, int pPredProb, int phalfLength,Point pCenterPoint, int pFoodPercentage,int pTotalFood, int pFoodGrowth
-        simulation->addObject(region1);
-        centerPoint = Point(125,125);
-        Region* region2 = new Region("region2",25,125,centerPoint,20,swampInitialFood,swampFoodRegen,swampMaxFood);
-        simulation->addObject(region2);
-        centerPoint = Point(-125,125);
-        Region* region3 = new Region("region3",75,125,centerPoint,30,swampInitialFood,swampFoodRegen,swampMaxFood);
-        simulation->addObject(region3);
-        centerPoint = Point(-125,-125);
-        Region* region4 = new Region("region4",25,125,centerPoint,20,swampInitialFood,swampFoodRegen,swampMaxFood);
-        simulation->addObject(region4);
-        std::vector<Region*> regions;
-        regions.push_back(region1);
-        regions.push_back(region2);
-        regions.push_back(region3);
-        regions.push_back(region4);
-        swamp->setRegions(regions);
-        Point predPoint = Point(125,125);
-        Collector = new DataCollector("Collector",clock, simulation); 
-        std::string predName = "pred1";
-        Predator* predator = new Predator(predName,50,predPoint,200,simulation,swamp);
-        for (int i = 0; i < snailCount;i++){
+        swamp = new Swamp("Swamp", params.foodRegen, params.maxFood, params.initialFood, simulation, params.width, params.length);
+        swamp->setClock(clock, params.maxAge);
+        simulation->addObject(swamp); // first, so lifecycle events land before the snails update
+
+        swamp->setRegions(buildRegions(params)); // regions are not simulation objects, their food grows lazily
+        swamp->setIndexTileSize(params.occupancyTileSize);
+        swamp->setReproProb(snailReproProb);
+        for (const PredatorSpec& spec : params.predators) {
+            simulation->addObject(new Predator(spec.name, snailPredProb, spec.position, 200, swamp));
+        }
+        Collector = new DataCollector("Collector",clock, simulation, swamp); 
+        Collector->setLedger(ledger);
+        Collector->setRecorder(recorder);
+        if (trajectoryMode != TrajectoryMode::None) {
+            Xoshiro256 fork = globalRng; // the sample draws its own numbers, the run's are left alone
+            Collector->setRecordTrajectories(trajectoryMode == TrajectoryMode::Sample ? params.trajectoryBudget : 0, params.trajectoryRate, fork.next());
+        }
+        forEachInitialSnail(snailCount, params, [&](long long i, int xPos, int yPos, int age) {
             std::string name = "Snail" + std::to_string(i);
-            int xPos = std::rand() % (2 * swampWidth + 1) - swampWidth; 
-            int yPos = std::rand() % (2 * swampLength + 1) - swampLength;
             Point startPos(xPos,yPos);
             Snail* snail = new Snail(
             name,
-            (rand() % snailMaxAge),
+            -1 - age, // the initial snails were born before tick 0
             snailReproProb,
             snailPredProb,
-            snailMaturityAge,
-            snailMaxAge,
-            snailMinOffspring,
-            snailMaxOffspring,
+            params.maturityAge,
+            params.maxAge,
+            params.minOffspring,
+            params.maxOffspring,
             startPos,
             *swamp
         );
             simulation->addObject(snail);
-        }
+        });
         simulation->addObject(Collector);
     };
     void setSimulation(Simulation* sim) { simulation = sim; }
+    void setLedger(MemoryLedger* pLedger) { ledger = pLedger; }
+    void setRecorder(RunRecorder* pRecorder) { recorder = pRecorder; }
+    void setOverrides(const ConfigOverrides& pOverrides) { overrides = pOverrides; }
+    void setTrajectoryMode(TrajectoryMode mode) { trajectoryMode = mode; }
 
     void setData(){
-        data = Collector->returnOutputData();
-        positionSummary = Collector->returnPositions();
+        trajectories = std::move(Collector->getTrajectories());
     }
 
 };
 
-class CSVWriter {
-private:
-    std::string csvFilePath_;
-    std::string posFilePath;
-    int predProb;
-    int reproProb;
-public:
-    CSVWriter(int predProb, int reproProb, const std::string& csvFilePath, const std::string& posFilePath)
-        : csvFilePath_(csvFilePath), posFilePath(posFilePath), predProb(predProb), reproProb(reproProb) {}
+// Scalable engine: snails are rows in a struct of arrays instead of heap objects,
+// so a snail costs ~16 bytes and a tick is one linear pass over the live rows.
+// a column of the population, which may start out in a mapped snapshot
+template <typename T>
+using Column = std::vector<T, MappedAllocator<T>>;
 
-    void createCSV(const std::vector<RegionsData> data, const std::vector<taggedPoint>& positions) {
-        // Check if CSV file exists
-        bool csvExists = false;
-        {
-            std::ifstream checkCsv(csvFilePath_);
-            csvExists = checkCsv.good();
-        }
+struct SnailPopulation {
+    Column<int> x;
+    Column<int> y;
+    Column<int> birthTick; // age = tick - birthTick, nothing to write per tick
+    Column<int8_t> healthIndex;
+    Column<int8_t> daysStarved;
+    Column<uint8_t> alive;
+    Column<uint8_t> mature;
+    Column<uint8_t> eaten; // marked by a predator this tick, dies on its update
+    std::vector<int32_t> track; // trajectory of each row, -1 until seen, -2 if not sampled; only kept when tracked
+    bool tracked = false;
+    size_t deadCount = 0;
 
-        std::ofstream mainFile(csvFilePath_, std::ios::app);
-        if (!mainFile.is_open()) {
-            throw std::runtime_error("Failed to open CSV file: " + csvFilePath_);
-        }
+    size_t size() const { return x.size(); }
+    size_t liveCount() const { return x.size() - deadCount; }
 
-        if (!csvExists) {
-            mainFile << "PredProb, ReproProb, Time, Number Of Snails\n";
-        }
-        int largestPop = 0;
-        int largestPopI = 0;
-        for (int aV = 0; aV < data.size();aV++){
-            if (data[aV].totalPop > largestPop){
-                largestPop = data[aV].totalPop;
-                largestPopI = aV;
-            }
+    void reserve(size_t count) {
+        x.reserve(count);
+        y.reserve(count);
+        birthTick.reserve(count);
+        healthIndex.reserve(count);
+        daysStarved.reserve(count);
+        alive.reserve(count);
+        mature.reserve(count);
+        eaten.reserve(count);
+        if (tracked) track.reserve(count);
+    }
+    void add(int pX, int pY, int pBirthTick, bool pMature) {
+        addCopies(pX, pY, pBirthTick, pMature, 1);
+    }
+    // count identical rows, e.g. a litter, filled column by column
+    void addCopies(int pX, int pY, int pBirthTick, bool pMature, size_t count) {
+        size_t n = x.size() + count;
+        x.resize(n, pX);
+        y.resize(n, pY);
+        birthTick.resize(n, pBirthTick);
+        healthIndex.resize(n, 3);
+        daysStarved.resize(n, 0);
+        alive.resize(n, 1);
+        mature.resize(n, pMature);
+        eaten.resize(n, 0);
+        if (tracked) track.resize(n, -1);
+    }
+    void kill(size_t i) {
+        alive[i] = 0;
+        deadCount++;
+    }
+    // drops dead rows, keeping the update order of the survivors
+    void compact() {
+        size_t out = 0;
+        for (size_t i = 0; i < x.size(); i++) {
+            if (!alive[i]) continue;
+            x[out] = x[i];
+            y[out] = y[i];
+            birthTick[out] = birthTick[i];
+            healthIndex[out] = healthIndex[i];
+            daysStarved[out] = daysStarved[i];
+            alive[out] = 1;
+            mature[out] = mature[i];
+            eaten[out] = eaten[i];
+            if (tracked) track[out] = track[i];
+            out++;
         }
+        x.resize(out);
+        y.resize(out);
+        birthTick.resize(out);
+        healthIndex.resize(out);
+        daysStarved.resize(out);
+        alive.resize(out);
+        mature.resize(out);
+        eaten.resize(out);
+        if (tracked) track.resize(out);
+        deadCount = 0;
+    }
 
-        mainFile << predProb << "," << reproProb << "," << data[largestPopI].time << "," << data[largestPopI].totalPop << "\n";
+    // calls visit(name, column) for every column but track, the order snapshots use
+    template <typename Visit>
+    void forEachColumn(Visit visit) {
+        visit("x", x);
+        visit("y", y);
+        visit("birthTick", birthTick);
+        visit("healthIndex", healthIndex);
+        visit("daysStarved", daysStarved);
+        visit("alive", alive);
+        visit("mature", mature);
+        visit("eaten", eaten);
+    }
+};
 
-        mainFile.close();
+// Population snapshots: "SNAILPOP", the header length as a little endian uint64 and a
+// JSON header (rows, the swamp's size, and each column's name, element size and
+// offset), then the columns, each starting on a page. A run maps the file
+// copy-on-write and uses the columns where they lie: pages are read when first
+// touched and only copied when the run first writes to them. The rows are the live
+// snails in birth order, so rows born together are runs for the lifecycle wheel, with
+// birth ticks counting back from the end of the run that saved them.
+class PopulationSnapshot {
+private:
+    static constexpr size_t PAGE = 4096;
+    std::shared_ptr<MappedFile> mapping; // shared with the columns adopted from it
+    json header;
+    size_t rows = 0;
 
-    
+    template <typename T>
+    T* column(const std::string& name) {
+        for (const json& spec : header.at("columns")) {
+            if (spec.at("name").get<std::string>() != name) continue;
+            size_t offset = spec.at("offset").get<size_t>();
+            if (spec.at("size").get<size_t>() != sizeof(T) || offset % alignof(T) != 0 || offset + rows * sizeof(T) > mapping->size()) {
+                break;
+            }
+            return reinterpret_cast<T*>(mapping->data() + offset);
+        }
+        throw std::runtime_error("Population snapshot " + mapping->getPath() + " has no usable column " + name);
     }
-};
-//First argument is number of snails, second is the length of the sim
-int main(int argc, char* argv[]) {
-    if (argc < 3) {
-        std::cerr << "Usage: " << argv[0] << " <snails> <simulationDuration>\n";
-        return 1;
+
+public:
+    explicit PopulationSnapshot(const std::string& path) : mapping(std::make_shared<MappedFile>(path)) {
+        uint64_t headerLength = 0;
+        if (mapping->size() < 16 || std::memcmp(mapping->data(), "SNAILPOP", 8) != 0 ||
+            (std::memcpy(&headerLength, mapping->data() + 8, sizeof(headerLength)), headerLength > mapping->size() - 16)) {
+            throw std::runtime_error("Not a population snapshot: " + path);
+        }
+        header = json::parse(mapping->data() + 16, mapping->data() + 16 + headerLength);
+        rows = header.at("rows").get<size_t>();
     }
 
-    int snails = std::stoi(argv[1]);
-    if (snails <= 0 || snails >= 1000) {
-        std::cerr << "Bad choice for number of snails.\n";
-        return 1;
+    size_t size() const { return rows; }
+    // snapshots only fit swamps of the size they were saved from, and snails of the same
+    // ages: the rows' birth ticks and mature flags were set under the saved maxAge and
+    // maturityAge, and a smaller maxAge would put their deaths in the past
+    void check(const SwampParams& params) const {
+        if (header.at("swampWidth").get<int>() != params.width || header.at("swampLength").get<int>() != params.length) {
+            throw std::runtime_error("Population snapshot " + mapping->getPath() + " is for a swamp of another size");
+        }
+        if (header.value("maxAge", -1) != params.maxAge || header.value("maturityAge", -1) != params.maturityAge) {
+            throw std::runtime_error("Population snapshot " + mapping->getPath() + " was saved with another maxAge or maturityAge");
+        }
+    }
+    // the population's columns start out as the mapped ones, nothing is copied; they
+    // keep the mapping for as long as they use it
+    void adoptInto(SnailPopulation& snails) {
+        snails.forEachColumn([&](const char* name, auto& target) {
+            using T = typename std::decay_t<decltype(target)>::value_type;
+            target = Column<T>(MappedAllocator<T>(mapping, column<T>(name), rows));
+            target.reserve(rows);
+            target.resize(rows);
+        });
+        snails.deadCount = 0;
     }
 
-    int duration = std::stoi(argv[2]);
-    if (duration <= 0 || duration >= 1000) {
-        std::cerr << "Bad choice for duration.\n";
-        return 1;
+    static void write(const std::string& path, SnailPopulation& snails, const SwampParams& params, int endTick) {
+        std::vector<uint32_t> order;
+        for (size_t i = 0; i < snails.size(); i++) {
+            if (snails.alive[i]) order.push_back(static_cast<uint32_t>(i));
+        }
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return snails.birthTick[a] < snails.birthTick[b]; });
+        // the offsets depend on the header's length and the other way round, so lay
+        // the file out until the header fits in front of the first column
+        json j;
+        size_t dataStart = PAGE;
+        std::string text;
+        while (true) {
+            j = {{"rows", order.size()}, {"swampWidth", params.width}, {"swampLength", params.length},
+                 {"maxAge", params.maxAge}, {"maturityAge", params.maturityAge}, {"savedAt", endTick}};
+            j["columns"] = json::array();
+            size_t offset = dataStart;
+            snails.forEachColumn([&](const char* name, auto& source) {
+                size_t bytes = order.size() * sizeof(source[0]);
+                j["columns"].push_back({{"name", name}, {"size", sizeof(source[0])}, {"offset", offset}});
+                offset += (bytes + PAGE - 1) / PAGE * PAGE;
+            });
+            text = j.dump();
+            if (16 + text.size() + 1 <= dataStart) break;
+            dataStart = (16 + text.size() + 1 + PAGE - 1) / PAGE * PAGE;
+        }
+        text.resize(dataStart - 16 - 1, ' ');
+        text += '\n';
+        std::ofstream out(path, std::ios::binary);
+        if (!out.is_open()) {
+            throw std::runtime_error("Failed to open population snapshot: " + path);
+        }
+        uint64_t headerLength = text.size();
+        out.write("SNAILPOP", 8);
+        out.write(reinterpret_cast<const char*>(&headerLength), sizeof(headerLength));
+        out << text;
+        snails.forEachColumn([&](const char* name, auto& source) {
+            using T = typename std::decay_t<decltype(source)>::value_type;
+            std::vector<T> gathered(order.size());
+            for (size_t k = 0; k < order.size(); k++) {
+                gathered[k] = source[order[k]];
+            }
+            if (std::string(name) == "birthTick") {
+                for (T& birthTick : gathered) birthTick -= endTick;
+            }
+            size_t bytes = gathered.size() * sizeof(T);
+            out.write(reinterpret_cast<const char*>(gathered.data()), static_cast<std::streamsize>(bytes));
+            for (size_t pad = bytes; pad % PAGE != 0; pad++) out.put('\0');
+        });
+        out.close();
+        if (!out) {
+            throw std::runtime_error("Failed to write population snapshot: " + path);
+        }
     }
+};
 
+// rows born together are next to each other, so their events cover a run of rows
+struct RowEvent {
+    uint32_t firstRow;
+    uint32_t count;
+    LifecycleEvent event;
+};
 
-    int startReproProb = 10;
-    int maxReproProb = 110;
-    int reproProbIncrement = 1;
-    int startPredProb = 25 ;
-    int maxPredProb = 125 ;
-    int predProbIncrement = 1;
+// a parent's litter, materialised with the others in one append after the snail loop
+struct Litter {
+    uint32_t parent;
+    uint32_t count;
+};
 
-    std::string configFile = "snailSim2.json";
+// Same rules as Snail::update, applied row by row. Dead rows are left in place
+// and compacted once they outnumber the live ones, so a tick stays linear in live snails.
+// Rows only move on compaction, which is when the lifecycle wheel gets rebuilt.
+class PopulationSim {
+private:
+    SwampParams params;
+    int reproProb;
+    int predProb;
+    Swamp swamp;
+    std::vector<Region*> regions;
+    std::unique_ptr<PopulationSnapshot> snapshot; // the snapshot the columns started in, if any
+    SnailPopulation snails;
+    TimingWheel<RowEvent> lifecycle;
+    SparseOccupancy occupancy;   // where the snails were at the start of the tick
+    std::vector<int> tileRegion; // region of each occupied tile, -1 if it straddles regions
+    SkipSampler hunt;            // predation trials, shared by the predators
+    SkipSampler reproduction;    // one trial per mature survivor per tick
+    std::vector<Litter> litters; // this tick's births, reused from tick to tick
+    // the snail phase runs in fixed blocks of rows, each with its own random stream,
+    // so the results do not depend on how many threads there are
+    static const size_t BLOCK_ROWS = 4096;
+    ThreadPool& pool;            // shared by every run in the process
+    uint64_t seed;
+    std::vector<int> rowRegion;  // region each row was in at the start of the tick
+    std::vector<uint8_t> rowFed; // whether it got its meal
+    std::vector<std::vector<Litter>> blockLitters;
+    std::vector<SkipSampler> blockTrials; // reproduction trials per block, kept from tick to tick
+    std::vector<size_t> blockDead;
+    RunRecorder* recorder = nullptr;
 
-// Create objects and set dependencies
-    srand(time(0));
-    for (int reproProb = startReproProb; reproProb < maxReproProb;reproProb+=reproProbIncrement){
-        for (int predProb = startPredProb; predProb < maxPredProb;predProb+=predProbIncrement){
-        SwampClock* clock = new SwampClock(0, duration);
-    
-        SwampConfig* swc = new SwampConfig(configFile, snails, duration, clock, reproProb, predProb);
-    
-        Simulation* world = new Simulation();
-    
-        // Set up relationships between objects
-        world->setClock(clock);
-        world->setConfig(swc);
-        swc->setSimulation(world);
-    
-        // Run the simulation
-        world->run();
-    
-        // Dynamically allocate CSVWriter
-        CSVWriter* csv_writer = new CSVWriter(predProb, reproProb, "snail2_data.csv","snail2pos_data.csv");
-    
-        // Set data and create CSV
-        swc->setData();
-        csv_writer->createCSV(swc->data,swc->positionSummary);
-    
-        // Clean up dynamically allocated memory
-        delete csv_writer;
-        delete world;
-        delete swc;
-        delete clock;
+    void rebuildOccupancy() {
+        occupancy.rebuild(snails.x.data(), snails.y.data(), snails.alive.data(), snails.size());
+        if (occupancy.slotsRenumbered()) {
+            tileRegion.clear();
+        }
+        size_t known = tileRegion.size(); // tiles keep their slot until renumbered, so only new ones need a lookup
+        tileRegion.resize(occupancy.tileCount());
+        for (size_t slot = known; slot < tileRegion.size(); slot++) {
+            int minX, minY, maxX, maxY;
+            occupancy.tileBounds(slot, minX, minY, maxX, maxY);
+            tileRegion[slot] = swamp.getRectRegion(minX, minY, maxX, maxY);
+        }
+    }
 
+    int regionOfRow(size_t i) {
+        int regionInt = tileRegion[occupancy.tileOf(i)]; // only tiles on a region border need the exact lookup
+        return regionInt >= 0 ? regionInt : swamp.getRegionInt(Point(snails.x[i], snails.y[i]));
     }
+    // Predator::update over the rows near each predator, from where the snails ended the last tick
+    void predation() {
+        int reachX = swamp.getMaxHalfWidth();
+        int reachY = swamp.getMaxHalfLength();
+        for (const PredatorSpec& predator : params.predators) {
+            Point p = predator.position;
+            occupancy.forEachTileInRect(p.x - reachX, p.y - reachY, p.x + reachX, p.y + reachY, [&](const uint32_t* rows, size_t count) {
+                // a tile in one region and wholly in reach is a run of trials to skip through
+                size_t slot = static_cast<size_t>(occupancy.tileOf(rows[0]));
+                if (tileRegion[slot] >= 0) {
+                    Region* region = regions[tileRegion[slot]];
+                    int minX, minY, maxX, maxY;
+                    occupancy.tileBounds(slot, minX, minY, maxX, maxY);
+                    IndexRect reach = {p.x - region->getRegionhalfWidth(), p.y - region->getRegionhalfLength(),
+                                       p.x + region->getRegionhalfWidth(), p.y + region->getRegionhalfLength()};
+                    if (reach.contains(IndexRect{minX, minY, maxX, maxY})) {
+                        hunt.trials(static_cast<long long>(count), uniformUnit, [&](long long k) { snails.eaten[rows[k]] = 1; });
+                        return;
+                    }
+                }
+                for (size_t k = 0; k < count; k++) {
+                    uint32_t i = rows[k];
+                    Region* region = regions[regionOfRow(i)];
+                    if (std::abs(snails.x[i] - p.x) <= region->getRegionhalfWidth() && std::abs(snails.y[i] - p.y) <= region->getRegionhalfLength()) {
+                        if (hunt.trial(uniformUnit)) {
+                            snails.eaten[i] = 1;
+                        }
+                    }
+                }
+            });
+        }
     }
-    std::cout << "No Errors ;). Output is at " "snail2_data.csv" " and " "snail2pos_data.csv" "\n";
-    return 0;
 
+    // events for rows [first, first + count), all born at birthTick; births at tick
+    // are scheduled after that tick has fired
+    void scheduleRows(size_t first, size_t count, int birthTick, bool mature) {
+        uint32_t row = static_cast<uint32_t>(first);
+        uint32_t rows = static_cast<uint32_t>(count);
+        if (!mature && params.maturityAge < params.maxAge) { // otherwise age death comes first, and is as far as the wheel reaches
+            lifecycle.schedule(birthTick + params.maturityAge + 1, RowEvent{row, rows, LifecycleEvent::Mature});
+        }
+        lifecycle.schedule(birthTick + params.maxAge + 1, RowEvent{row, rows, LifecycleEvent::AgeDeath});
+    }
+    void addSnail(int x, int y, int birthTick, int tick) {
+        bool mature = birthTick + params.maturityAge + 1 < tick;
+        scheduleRows(snails.size(), 1, birthTick, mature);
+        snails.add(x, y, birthTick, mature);
+    }
+    // this tick's litters, appended in the order the parents reproduced
+    void addLitters(int tick) {
+        size_t first = snails.size();
+        for (const Litter& litter : litters) {
+            snails.addCopies(snails.x[litter.parent], snails.y[litter.parent], tick, false, litter.count);
+        }
+        if (snails.size() > first) {
+            scheduleRows(first, snails.size() - first, tick, false);
+        }
+        litters.clear();
+    }
+    void compact() {
+        snails.compact();
+        if (snails.tracked && trajectories.sampling()) {
+            trajectories.setAllOwners(NO_ROW); // the dead keep their slots until evicted, nothing to mark
+            for (size_t i = 0; i < snails.size(); i++) {
+                if (snails.track[i] >= 0) trajectories.setOwner(snails.track[i], static_cast<uint32_t>(i));
+            }
+        }
+        scheduleAllRows(); // survivors keep their order, so rows born together are still runs
+    }
+    void scheduleAllRows() {
+        lifecycle.clear();
+        size_t first = 0;
+        for (size_t i = 1; i <= snails.size(); i++) {
+            if (i < snails.size() && snails.birthTick[i] == snails.birthTick[first] && snails.mature[i] == snails.mature[first]) continue;
+            scheduleRows(first, i - first, snails.birthTick[first], snails.mature[first]);
+            first = i;
+        }
+    }
 
+public:
+    PopulationSim(const SwampParams& pParams, int snailCount, int pReproProb, int pPredProb, ThreadPool& pPool)
+        : params(pParams), reproProb(pReproProb), predProb(pPredProb),
+          swamp("Swamp", pParams.foodRegen, pParams.maxFood, pParams.initialFood, nullptr, pParams.width, pParams.length),
+          lifecycle(pParams.maxAge + 1), occupancy(pParams.occupancyTileSize), hunt(1.0 / pPredProb), reproduction(1.0 / pReproProb),
+          pool(pPool), seed(globalRng.next()) {
+        regions = buildRegions(params);
+        swamp.setRegions(regions);
+        snails.reserve(snailCount);
+        forEachInitialSnail(snailCount, params, [&](long long, int xPos, int yPos, int age) {
+            addSnail(xPos, yPos, -1 - age, 0);
+        });
+    }
+    // starts from the snapshot's snails instead, in the mapping
+    PopulationSim(const SwampParams& pParams, std::unique_ptr<PopulationSnapshot> pSnapshot, int pReproProb, int pPredProb, ThreadPool& pPool)
+        : PopulationSim(pParams, 0, pReproProb, pPredProb, pPool) {
+        snapshot = std::move(pSnapshot);
+        snapshot->check(params);
+        snapshot->adoptInto(snails);
+        scheduleAllRows();
+    }
+    PopulationSim(const PopulationSim&) = delete;
+    PopulationSim& operator=(const PopulationSim&) = delete;
 
+    MemoryLedger ledger;
+    static constexpr uint32_t NO_ROW = 0xffffffffu;
+    TrajectoryRecorder<uint32_t> trajectories; // owners are rows
 
-   
+    // snails' paths from here on, taken at the end of each tick: every snail's with a
+    // budget of 0, otherwise a sample of budget snails
+    void recordTrajectories(size_t budget = 0, double rate = 1.0) {
+        snails.tracked = true;
+        snails.track.assign(snails.size(), -1);
+        trajectories = TrajectoryRecorder<uint32_t>(budget, rate, StreamRng(seed, 0x73616d70ULL).next());
+    }
+    void setRecorder(RunRecorder* pRecorder) { recorder = pRecorder; }
 
-}
+    void updateLedger() {
+        size_t populationBytes = vectorBytes(snails.x) + vectorBytes(snails.y) + vectorBytes(snails.birthTick) +
+                                 vectorBytes(snails.healthIndex) + vectorBytes(snails.daysStarved) + vectorBytes(snails.alive) +
+                                 vectorBytes(snails.mature) + vectorBytes(snails.eaten) + vectorBytes(snails.track) + lifecycle.bytes() + vectorBytes(litters) +
+                                 vectorBytes(rowRegion) + vectorBytes(rowFed) + vectorBytes(blockDead) + vectorBytes(blockTrials);
+        for (const std::vector<Litter>& born : blockLitters) {
+            populationBytes += vectorBytes(born);
+        }
+        ledger.set(MemoryCategory::Population, populationBytes);
+        ledger.set(MemoryCategory::SpatialIndex, vectorBytes(regions) + regions.size() * sizeof(Region) + swamp.indexBytes() +
+                                                 occupancy.bytes() + vectorBytes(tileRegion));
+        ledger.set(MemoryCategory::CollectorHistory, (recorder ? recorder->bytes() : 0) + trajectories.bytes());
+    }
+    const SparseOccupancy& getOccupancy() const { return occupancy; }
 
+    void step(int tick) {
+        // time per phase for the live metrics, a clock read between phases
+        auto lapStart = std::chrono::steady_clock::now();
+        auto lap = [&](LiveMetrics::StepPhase phase) {
+            auto now = std::chrono::steady_clock::now();
+            liveMetrics.addStepPhase(phase, now - lapStart);
+            lapStart = now;
+        };
+        RegionsData entry = RegionsData{};
+        entry.time = tick;
+        entry.regions.assign(regions.size(), RegionData{0, 0});
+        lifecycle.fire(tick, [this](const RowEvent& e) {
+            for (uint32_t row = e.firstRow; row < e.firstRow + e.count; row++) {
+                if (!snails.alive[row]) continue;
+                if (e.event == LifecycleEvent::Mature) {
+                    snails.mature[row] = 1;
+                } else {
+                    snails.kill(row);
+                }
+            }
+        });
+        lap(LiveMetrics::Lifecycle);
+        rebuildOccupancy();
+        lap(LiveMetrics::Occupancy);
+        predation();
+        lap(LiveMetrics::Predation);
+
+        size_t numSnails = snails.size(); // newborns wait for the next tick
+        size_t numBlocks = (numSnails + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        rowRegion.resize(numSnails);
+        rowFed.resize(numSnails);
+        blockDead.assign(numBlocks, 0);
+        if (blockLitters.size() < numBlocks) blockLitters.resize(numBlocks);
+        if (blockTrials.size() < numBlocks) blockTrials.resize(numBlocks, reproduction); // the gap is memoryless, so a new block may start afresh
+
+        // region lookup and movement, block by block in parallel
+        pool.parallelFor(numBlocks, [&](size_t block) {
+            StreamRng rng(seed, static_cast<uint64_t>(tick), block, 0);
+            size_t begin = block * BLOCK_ROWS;
+            size_t end = std::min(numSnails, begin + BLOCK_ROWS);
+            uint32_t steps[2 * BLOCK_ROWS]; // every row's x and y step, drawn in one go
+            rng.fillBelow(steps, 2 * (end - begin), 3);
+            for (size_t i = begin; i < end; i++) {
+                if (!snails.alive[i]) continue;
+                rowRegion[i] = regionOfRow(i);
+                const uint32_t* step = &steps[2 * (i - begin)];
+                Point pos(snails.x[i] + static_cast<int>(step[0]) - 1, snails.y[i] + static_cast<int>(step[1]) - 1);
+                pos = swamp.checkPos(pos);
+                snails.x[i] = pos.x;
+                snails.y[i] = pos.y;
+            }
+        });
+        lap(LiveMetrics::Movement);
+
+        // feeding depends on who ate first, so it stays one pass in row order
+        for (size_t i = 0; i < numSnails; i++) {
+            if (!snails.alive[i]) continue;
+            int age = tick - snails.birthTick[i];
+            int mealSize = std::min(20, static_cast<int>(age*0.1));
+            rowFed[i] = regions[rowRegion[i]]->getFood(mealSize, tick) != 0;
+            bool starvedOut = !rowFed[i] && snails.daysStarved[i] + 1 > 10;
+            if (!starvedOut && !snails.eaten[i]) {
+                entry.regions[rowRegion[i]].numOfSnails += 1;
+                entry.totalPop += 1;
+            }
+        }
+        lap(LiveMetrics::Feeding);
+
+        // health, deaths and reproduction, births into a buffer per block
+        pool.parallelFor(numBlocks, [&](size_t block) {
+            StreamRng rng(seed, static_cast<uint64_t>(tick), block, 1);
+            SkipSampler& trials = blockTrials[block];
+            std::vector<Litter>& born = blockLitters[block];
+            for (size_t i = block * BLOCK_ROWS; i < std::min(numSnails, (block + 1) * BLOCK_ROWS); i++) {
+                if (!snails.alive[i]) continue;
+                bool eaten = snails.eaten[i];
+                snails.eaten[i] = 0;
+                int healthIndex = snails.healthIndex[i];
+                if (!rowFed[i]) {
+                    snails.daysStarved[i] += 1;
+                    healthIndex = std::max(healthIndex-1,1);
+                    snails.healthIndex[i] = healthIndex;
+                    if (snails.daysStarved[i] > 10) {
+                        snails.alive[i] = 0;
+                        blockDead[block]++;
+                        continue;
+                    }
+                }
+                else {
+                    snails.daysStarved[i] = 0;
+                    healthIndex = std::min(healthIndex+1,5);
+                    snails.healthIndex[i] = healthIndex;
+                }
+                if (eaten) {
+                    snails.alive[i] = 0;
+                    blockDead[block]++;
+                    continue;
+                }
+                if (snails.mature[i] && trials.trial([&] { return rng.unit(); })) {
+                    uint32_t litterRange = static_cast<uint32_t>((healthIndex*params.maxOffspring) - (healthIndex*params.minOffspring) + 1);
+                    int numOffspring = params.minOffspring + static_cast<int>(rng.below(litterRange));
+                    born.push_back(Litter{static_cast<uint32_t>(i), static_cast<uint32_t>(numOffspring)});
+                }
+            }
+        });
+
+        // merged in block order, which is row order, whatever thread ran which block
+        for (size_t block = 0; block < numBlocks; block++) {
+            snails.deadCount += blockDead[block];
+            for (const Litter& litter : blockLitters[block]) {
+                int birthRegion = swamp.getRegionInt(Point(snails.x[litter.parent], snails.y[litter.parent]));
+                entry.regions[birthRegion].numOfSnails += litter.count;
+                entry.totalPop += litter.count;
+                litters.push_back(litter);
+            }
+            blockLitters[block].clear();
+        }
+        addLitters(tick);
+        lap(LiveMetrics::Breeding);
+        for (size_t r = 0; r < regions.size(); r++) {
+            entry.regions[r].foodLevel = regions[r]->getFoodLevel(tick);
+        }
+        if (recorder) recorder->add(std::move(entry));
+        if (snails.tracked) {
+            auto evict = [this](uint32_t row) {
+                if (row != NO_ROW) snails.track[row] = TrajectoryRecorder<uint32_t>::SKIPPED;
+            };
+            for (size_t i = 0; i < snails.size(); i++) {
+                if (!snails.alive[i]) continue;
+                snails.track[i] = trajectories.record(snails.track[i], static_cast<uint32_t>(i), tick, snails.x[i], snails.y[i], evict);
+            }
+        }
+        if (recorder && recorder->wantsPositions()) { // the dead rows count for nothing, no need to skip them
+            recorder->addPositions(tick, swamp.getSwampBounds(), snails.x.data(), snails.y.data(), snails.alive.data(), snails.size());
+        }
+        updateLedger(); // before compaction, while the dead rows still take up space
+        lap(LiveMetrics::Output);
+
+        if (snails.deadCount > snails.liveCount()) {
+            compact();
+        }
+        lap(LiveMetrics::Lifecycle);
+    }
+
+    void run(int duration) {
+        for (int tick = 0; tick < duration; tick++) {
+            step(tick);
+        }
+    }
+    // the live snails after endTick ticks, for later runs to start from
+    void saveSnapshot(const std::string& path, int endTick) { PopulationSnapshot::write(path, snails, params, endTick); }
+};
+
+// Aggregate engine: a region's snails are only counts per (age, healthIndex, daysStarved)
+// bin, and the per snail rules become binomial/multinomial draws over whole bins, so a
+// tick costs O(occupied bins) however many snails there are. Snails are assumed to be
+// spread evenly over their region, which is all that is needed to know how many cross
+// into a neighbouring region.
+class CohortSim {
+private:
+    static const int HEALTH_LEVELS = 5;   // healthIndex 1..5
+    static const int STARVE_LEVELS = 11;  // daysStarved 0..10, one more day is fatal
+    struct Exit {
+        int region;
+        double prob; // chance per tick of a snail stepping into that region
+    };
+
+    SwampParams params;
+    int reproProb;
+    int predProb;
+    Swamp swamp;
+    std::vector<Region*> regions;
+    std::vector<std::vector<long long>> counts; // [region][bin]
+    std::vector<std::vector<long long>> nextCounts;
+    std::vector<std::vector<int>> occupied;     // bins with snails, per region
+    std::vector<std::vector<int>> nextOccupied;
+    std::vector<std::vector<Exit>> exits;       // [region], neighbours along the whole border
+    std::vector<double> eatenProb;              // chance per tick of being taken by a predator
+    Xoshiro256 rng;
+    RunRecorder* recorder = nullptr;
+
+    int binIndex(int age, int healthIndex, int daysStarved) const {
+        return (age * HEALTH_LEVELS + (healthIndex - 1)) * STARVE_LEVELS + daysStarved;
+    }
+    long long binomial(long long n, double p) {
+        if (n <= 0 || p <= 0.0) return 0;
+        if (p >= 1.0) return n;
+        std::binomial_distribution<long long> draw(n, p);
+        return draw(rng);
+    }
+    // n split over outcomes in proportion to weights, one binomial per outcome
+    std::vector<long long> multinomial(long long n, const std::vector<double>& weights) {
+        double remainingWeight = 0.0;
+        for (double weight : weights) remainingWeight += weight;
+        std::vector<long long> drawn(weights.size(), 0);
+        for (size_t i = 0; i < weights.size() && n > 0; i++) {
+            drawn[i] = i + 1 == weights.size() ? n : binomial(n, std::min(1.0, weights[i] / remainingWeight));
+            n -= drawn[i];
+            remainingWeight -= weights[i];
+        }
+        return drawn;
+    }
+    // offspring of parents litters, each uniform on [minOffspring, minOffspring + range);
+    // a few litters are drawn one by one, more as a normal with the sum's mean and variance
+    long long litterTotal(long long parents, int range) {
+        const long long EXACT_LITTERS = 16;
+        if (parents <= 0) return 0;
+        long long least = parents * params.minOffspring;
+        if (range <= 1) return least;
+        if (parents < EXACT_LITTERS) {
+            long long total = least;
+            for (long long k = 0; k < parents; k++) {
+                total += rng.below(static_cast<uint32_t>(range));
+            }
+            return total;
+        }
+        double mean = parents * (range - 1) / 2.0;
+        double variance = parents * (static_cast<double>(range) * range - 1.0) / 12.0;
+        std::normal_distribution<double> draw(mean, std::sqrt(variance));
+        long long extra = std::llround(draw(rng));
+        return least + std::min(std::max(extra, 0LL), parents * (range - 1));
+    }
+    void addTo(int region, int bin, long long n) {
+        if (n <= 0) return;
+        if (nextCounts[region][bin] == 0) {
+            nextOccupied[region].push_back(bin);
+        }
+        nextCounts[region][bin] += n;
+    }
+    // multinomial split of n survivors over staying and the regions around this one
+    void moveOut(int region, int bin, long long n) {
+        double remainingProb = 1.0;
+        for (const Exit& exit : exits[region]) {
+            long long moved = binomial(n, std::min(1.0, exit.prob / remainingProb));
+            addTo(exit.region, bin, moved);
+            n -= moved;
+            remainingProb -= exit.prob;
+        }
+        addTo(region, bin, n);
+    }
+    // where snails at the border of a region step to: a snail is on a given outer
+    // column with chance 1/width and then steps outwards one move in three; cells
+    // past the swamp edge are clamped, so those snails stay
+    std::vector<Exit> findExits(size_t r) {
+        const IndexRect& b = regions[r]->getBounds();
+        double width = b.maxX - b.minX + 1;
+        double length = b.maxY - b.minY + 1;
+        std::vector<Exit> found;
+        auto step = [&](int x, int y, double prob) {
+            if (std::abs(x) > params.width || std::abs(y) > params.length) return;
+            int neighbour = swamp.getRegionInt(Point(x, y));
+            if (neighbour < 0 || neighbour == static_cast<int>(r)) return;
+            for (Exit& exit : found) {
+                if (exit.region == neighbour) {
+                    exit.prob += prob;
+                    return;
+                }
+            }
+            found.push_back(Exit{neighbour, prob});
+        };
+        for (int y = b.minY; y <= b.maxY; y++) {
+            step(b.maxX + 1, y, 1.0 / (3.0 * width * length));
+            step(b.minX - 1, y, 1.0 / (3.0 * width * length));
+        }
+        for (int x = b.minX; x <= b.maxX; x++) {
+            step(x, b.maxY + 1, 1.0 / (3.0 * width * length));
+            step(x, b.minY - 1, 1.0 / (3.0 * width * length));
+        }
+        return found;
+    }
+    // fraction of a region inside a predator's reach, the predator using the region's half sizes
+    double coverage(Region* region, Point predator) const {
+        const IndexRect& b = region->getBounds();
+        int halfWidth = region->getRegionhalfWidth();
+        int halfLength = region->getRegionhalfLength();
+        double overlapX = std::max(0, std::min(b.maxX, predator.x + halfWidth) - std::max(b.minX, predator.x - halfWidth) + 1);
+        double overlapY = std::max(0, std::min(b.maxY, predator.y + halfLength) - std::max(b.minY, predator.y - halfLength) + 1);
+        return (overlapX * overlapY) / ((b.maxX - b.minX + 1.0) * (b.maxY - b.minY + 1.0));
+    }
+
+public:
+    CohortSim(const SwampParams& pParams, long long snailCount, int pReproProb, int pPredProb)
+        : params(pParams), reproProb(pReproProb), predProb(pPredProb),
+          swamp("Swamp", pParams.foodRegen, pParams.maxFood, pParams.initialFood, nullptr, pParams.width, pParams.length),
+          rng(globalRng.next()) {
+        regions = buildRegions(params);
+        swamp.setRegions(regions);
+        size_t numRegions = regions.size();
+        size_t numBins = static_cast<size_t>(params.maxAge + 1) * HEALTH_LEVELS * STARVE_LEVELS;
+        counts.assign(numRegions, std::vector<long long>(numBins, 0));
+        nextCounts = counts;
+        occupied.assign(numRegions, std::vector<int>());
+        nextOccupied = occupied;
+
+        for (size_t r = 0; r < numRegions; r++) {
+            exits.push_back(findExits(r));
+
+            double survive = 1.0;
+            for (const PredatorSpec& predator : params.predators) {
+                survive *= 1.0 - coverage(regions[r], predator.position) / predProb;
+            }
+            eatenProb.push_back(1.0 - survive);
+        }
+
+        // the other engines place snails on a uniform cell with a uniform age below maxAge,
+        // so the starting bins are a multinomial over regions by area, then over ages
+        std::vector<long long> cells = swamp.getRegionCells();
+        std::vector<double> areaWeights(cells.begin(), cells.end());
+        std::vector<double> ageWeights(static_cast<size_t>(params.maxAge), 1.0);
+        std::vector<long long> perRegion = multinomial(snailCount, areaWeights);
+        for (size_t r = 0; r < numRegions; r++) {
+            std::vector<long long> perAge = multinomial(perRegion[r], ageWeights);
+            for (int age = 0; age < params.maxAge; age++) {
+                if (perAge[age] == 0) continue;
+                int bin = binIndex(age, 3, 0);
+                occupied[r].push_back(bin);
+                counts[r][bin] = perAge[age];
+            }
+        }
+    }
+    CohortSim(const CohortSim&) = delete;
+    CohortSim& operator=(const CohortSim&) = delete;
+
+    MemoryLedger ledger;
+
+    void setRecorder(RunRecorder* pRecorder) { recorder = pRecorder; }
+
+    void step(int tick) {
+        RegionsData entry = RegionsData{};
+        entry.time = tick;
+        entry.regions.assign(regions.size(), RegionData{0, 0});
+
+        for (size_t r = 0; r < regions.size(); r++) {
+            // the object engine feeds snails in the order they were added, which is oldest
+            // first, so bins queue for food by age with the oldest at the front
+            std::sort(occupied[r].begin(), occupied[r].end(), std::greater<int>());
+            long long newborns = 0;
+            for (int bin : occupied[r]) {
+                long long n = counts[r][bin];
+                counts[r][bin] = 0;
+                int daysStarved = bin % STARVE_LEVELS;
+                int healthIndex = (bin / STARVE_LEVELS) % HEALTH_LEVELS + 1;
+                int age = bin / (STARVE_LEVELS * HEALTH_LEVELS) + 1;
+                if (age > params.maxAge) continue;
+                int mealSize = std::min(20, static_cast<int>(age*0.1));
+
+                // getFood hands out whole meals while they last; a zero meal counts as starving
+                long long fed = 0;
+                if (mealSize > 0) {
+                    fed = std::min<long long>(n, regions[r]->getFoodLevel(tick) / mealSize);
+                    if (fed > 0) {
+                        regions[r]->getFood(static_cast<int>(fed * mealSize), tick);
+                    }
+                }
+                long long starved = daysStarved + 1 > 10 ? 0 : n - fed;
+
+                struct Group { long long count; int healthIndex; int daysStarved; };
+                Group groups[2] = {{fed, std::min(healthIndex + 1, 5), 0},
+                                   {starved, std::max(healthIndex - 1, 1), daysStarved + 1}};
+                for (Group& group : groups) {
+                    group.count -= binomial(group.count, eatenProb[r]);
+                    if (group.count == 0) continue;
+                    entry.regions[r].numOfSnails += group.count;
+                    if (age > params.maturityAge) {
+                        long long parents = binomial(group.count, 1.0 / reproProb);
+                        int litterRange = group.healthIndex * params.maxOffspring - group.healthIndex * params.minOffspring + 1;
+                        newborns += litterTotal(parents, litterRange);
+                    }
+                    moveOut(r, binIndex(age, group.healthIndex, group.daysStarved), group.count);
+                }
+            }
+            occupied[r].clear();
+            // newborns stay put until their first tick
+            addTo(r, binIndex(0, 3, 0), newborns);
+            entry.regions[r].numOfSnails += newborns;
+        }
+        for (size_t r = 0; r < regions.size(); r++) {
+            entry.regions[r].foodLevel = regions[r]->getFoodLevel(tick);
+            entry.totalPop += entry.regions[r].numOfSnails;
+        }
+        std::swap(counts, nextCounts);
+        std::swap(occupied, nextOccupied);
+        if (recorder) recorder->add(std::move(entry));
+
+        size_t binBytes = 0;
+        for (size_t r = 0; r < regions.size(); r++) {
+            binBytes += vectorBytes(counts[r]) + vectorBytes(nextCounts[r]) + vectorBytes(occupied[r]) + vectorBytes(nextOccupied[r]);
+        }
+        ledger.set(MemoryCategory::Population, binBytes);
+        size_t exitBytes = vectorBytes(exits);
+        for (const std::vector<Exit>& regionExits : exits) {
+            exitBytes += vectorBytes(regionExits);
+        }
+        ledger.set(MemoryCategory::SpatialIndex, vectorBytes(regions) + regions.size() * sizeof(Region) + swamp.indexBytes() + exitBytes);
+        ledger.set(MemoryCategory::CollectorHistory, recorder ? recorder->bytes() : 0);
+    }
+
+    void run(int duration) {
+        for (int tick = 0; tick < duration; tick++) {
+            step(tick);
+        }
+    }
+};
+
+// Streaming mean/variance (Welford) so replicates never have to be stored
+struct RunningStats {
+    int count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    void add(double value) {
+        count += 1;
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+    }
+    double variance() const { return count > 1 ? m2 / (count - 1) : 0.0; }
+    double stdDev() const { return std::sqrt(variance()); }
+
+    // half width of the 95% confidence interval of the mean (Student t)
+    double halfWidth() const {
+        static const double tTable[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                          2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                          2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+        if (count < 2) {
+            return std::numeric_limits<double>::infinity();
+        }
+        int dof = count - 1;
+        double t = dof <= 30 ? tTable[dof - 1] : 1.96;
+        return t * stdDev() / std::sqrt(count);
+    }
+};
+
+// peak of a single run, the old CSV row
+struct RunSummary {
+    int peakPop;
+    int peakTime;
+    long long snailTicks; // live snails summed over ticks
+    double seconds;
+    MemoryLedger memory;
+    int extinctionTick = -1; // -1 if some snails lived to the end
+    std::vector<RegionsData> series; // the run's per tick data, only kept when written out
+    TrajectoryStore trajectories;    // empty unless recorded
+};
+
+// after the last tick; the series, if kept, moves into the summary
+RunSummary summarizeRun(RunRecorder& recorder) {
+    recorder.finish();
+    return RunSummary{recorder.getPeakPop(), recorder.getPeakTime(), recorder.getSnailTicks(), 0.0, MemoryLedger{},
+                      recorder.getExtinctionTick(), std::move(recorder.getSeries()), TrajectoryStore{}};
+}
+
+// sequential stopping rule for the replicates of one sweep cell
+struct ReplicateOptions {
+    int minReplicates = 3;
+    int maxReplicates = 30;
+    double ciTarget = 0.05; // CI half width as a fraction of the mean
+};
+
+// snail-ticks per second of simulation time
+struct Throughput {
+    long long snailTicks = 0;
+    double seconds = 0.0;
+
+    void add(long long pSnailTicks, double pSeconds) {
+        snailTicks += pSnailTicks;
+        seconds += pSeconds;
+    }
+    double rate() const { return seconds > 0.0 ? snailTicks / seconds : 0.0; }
+};
+
+enum class MemoryReportMode {
+    None,
+    Text, // one line per cell on stdout
+    Json  // snail2_memory.json
+};
+
+enum class ArrowOutput {
+    None,
+    Results, // snail2_data.arrow, the CSV's rows plus throughput and memory
+    All      // and snail2_series.arrow, every replicate's per tick series
+};
+
+enum class MatrixOutput {
+    None,
+    Binary, // snail2_matrix.bin, a JSON header then the float64 planes
+    Csv     // snail2_matrix.<field>.csv, one pivoted table per field
+};
+
+enum class Engine {
+    Object,     // one SimulationObject per snail
+    Population, // PopulationSim, for large swamps
+    Cohort      // CohortSim, counts per age/health/starvation bin
+};
+
+// everything a worker needs to run any cell of the sweep
+struct SweepSettings {
+    std::string configFile;
+    std::string sweepFile; // the sweep spec
+    std::string populationFile; // snapshot every population engine run starts from, random snails if empty
+    std::string savePopulation; // where to save the population after one run instead of sweeping
+    std::string metricsPath;    // Prometheus text file, or socket, for live metrics; none if empty
+    bool metricsSocket = false;
+    double metricsInterval = 5;
+    int snails;
+    int duration;
+    Engine engine = Engine::Object;
+    ReplicateOptions replicates;
+    int reproProb = 0; // pins the axis to one value when non-zero
+    int predProb = 0;
+    MemoryReportMode memoryReport = MemoryReportMode::None;
+    ArrowOutput arrow = ArrowOutput::None;
+    MatrixOutput matrix = MatrixOutput::None;
+    TrajectoryMode trajectories = TrajectoryMode::None; // object and population engines
+    int windowTicks = 0; // window summaries of each replicate's series, off at 0
+    int windowStep = 0;  // ticks between windows, windowTicks (tumbling) unless given
+    int heatmapCell = 0;  // side of a heatmap cell in swamp cells, no heatmaps at 0
+    int heatmapTicks = 0; // ticks per heatmap, 0 for one per run
+    unsigned threads = 1; // for the population engine's snail phase
+    uint64_t seed = 0;    // for the random generator, the time unless given
+    bool seedGiven = false; // queue workers without --seed take the queue's
+    std::string queueDir; // shared job directory, empty unless sweeping through a queue
+    double leaseSeconds = 600;
+};
+
+// one point of the parameter sweep, a row of the sweep table
+struct SweepCell {
+    size_t index = 0;
+    int reproProb = 0;
+    int predProb = 0;
+    ConfigOverrides overrides; // the other swept parameters, in axis order
+};
+
+// The sweep compiled into a flat table with a row of parameter values per cell:
+// every combination of the axes' values, the last axis varying fastest. A cell is
+// its row number, so handing out work is handing out numbers, and any worker that
+// compiled the same spec turns one back into the cell.
+class SweepTable {
+public:
+    struct Axis {
+        std::string name;
+        std::vector<int> values;
+    };
+
+private:
+    std::vector<Axis> axes;
+    std::vector<int> table; // cells x axes
+    size_t numCells = 1;
+    size_t reproAxis = 0;
+    size_t predAxis = 0;
+
+public:
+    // the axes have to include reproProb and predProb
+    explicit SweepTable(std::vector<Axis> pAxes) : axes(std::move(pAxes)) {
+        reproAxis = predAxis = axes.size();
+        for (size_t a = 0; a < axes.size(); a++) {
+            if (axes[a].values.empty()) {
+                throw std::runtime_error("Sweep parameter " + axes[a].name + " has no values");
+            }
+            for (size_t b = 0; b < a; b++) {
+                if (axes[b].name == axes[a].name) {
+                    throw std::runtime_error("Sweep parameter " + axes[a].name + " is given twice");
+                }
+            }
+            if (axes[a].name == "reproProb") reproAxis = a;
+            if (axes[a].name == "predProb") predAxis = a;
+            if (numCells > static_cast<size_t>(std::numeric_limits<int>::max()) / axes[a].values.size()) {
+                throw std::runtime_error("Sweep has too many cells");
+            }
+            numCells *= axes[a].values.size();
+        }
+        if (reproAxis == axes.size() || predAxis == axes.size()) {
+            throw std::runtime_error("Sweep needs reproProb and predProb");
+        }
+        table.resize(numCells * axes.size());
+        for (size_t cell = 0; cell < numCells; cell++) {
+            size_t rest = cell;
+            for (size_t a = axes.size(); a-- > 0;) {
+                table[cell * axes.size() + a] = axes[a].values[rest % axes[a].values.size()];
+                rest /= axes[a].values.size();
+            }
+        }
+    }
+
+    size_t size() const { return numCells; }
+    const std::vector<Axis>& getAxes() const { return axes; }
+
+    SweepCell cell(size_t index) const {
+        const int* row = &table[index * axes.size()];
+        SweepCell cell{index, row[reproAxis], row[predAxis], {}};
+        for (size_t a = 0; a < axes.size(); a++) {
+            if (a != reproAxis && a != predAxis) cell.overrides.push_back({axes[a].name, row[a]});
+        }
+        return cell;
+    }
+
+    json toJson() const {
+        json j = json::array();
+        for (const Axis& axis : axes) j.push_back({{"name", axis.name}, {"values", axis.values}});
+        return j;
+    }
+    size_t bytes() const { return vectorBytes(table); }
+};
+
+struct CellResult {
+    int reproProb = 0;
+    int predProb = 0;
+    size_t cell = 0;
+    ConfigOverrides overrides{};
+    RunningStats peakPop{};
+    RunningStats peakTime{};
+    RunningStats extinctionTick{}; // over the replicates that died out
+    Throughput throughput{};
+    MemoryLedger memory{}; // high water over the cell's replicates
+    size_t peakRss = 0;
+
+    bool converged(double ciTarget) const {
+        return peakPop.halfWidth() <= ciTarget * std::max(peakPop.mean, 1.0) &&
+               peakTime.halfWidth() <= ciTarget * std::max(peakTime.mean, 1.0);
+    }
+};
+
+RunSummary runObjectReplicate(const SweepSettings& settings, const SweepCell& cell, RunRecorder& recorder) {
+    PhaseTimer phase(liveMetrics, LiveMetrics::Setup);
+    SwampClock* clock = new SwampClock(0, settings.duration);
+    SwampConfig* swc = new SwampConfig(settings.configFile, settings.snails, settings.duration, clock, cell.reproProb, cell.predProb);
+    Simulation* world = new Simulation();
+    MemoryLedger ledger;
+
+    // Set up relationships between objects
+    world->setClock(clock);
+    world->setConfig(swc);
+    swc->setSimulation(world);
+    swc->setLedger(&ledger);
+    swc->setRecorder(&recorder);
+    swc->setOverrides(cell.overrides);
+    swc->setTrajectoryMode(settings.trajectories);
+
+    // Run the simulation
+    phase.switchTo(LiveMetrics::Simulate); // the swamp is configured at the start of the run, so counts here
+    world->run();
+    phase.switchTo(LiveMetrics::Record);
+    swc->setData();
+    RunSummary summary = summarizeRun(recorder);
+    summary.memory = ledger;
+    summary.trajectories = std::move(swc->trajectories);
+
+    // Clean up dynamically allocated memory
+    delete world;
+    delete swc;
+    delete clock;
+    return summary;
+}
+
+// the population engine's threads, started by the first run and kept for every later
+// one in the process, so a sweep pays for them once per worker or rank
+ThreadPool& populationPool(unsigned threads) {
+    static ThreadPool pool(threads);
+    return pool;
+}
+
+RunSummary runPopulationReplicate(const SweepSettings& settings, const SweepCell& cell, RunRecorder& recorder) {
+    PhaseTimer phase(liveMetrics, LiveMetrics::Setup);
+    SwampParams params = readSwampParams(settings.configFile, cell.overrides);
+    std::unique_ptr<PopulationSim> made;
+    if (settings.populationFile.empty()) {
+        made.reset(new PopulationSim(params, settings.snails, cell.reproProb, cell.predProb, populationPool(settings.threads)));
+    } else { // mapped afresh, so every run starts from the file's snails
+        std::unique_ptr<PopulationSnapshot> snapshot(new PopulationSnapshot(settings.populationFile));
+        made.reset(new PopulationSim(params, std::move(snapshot), cell.reproProb, cell.predProb, populationPool(settings.threads)));
+    }
+    PopulationSim& sim = *made;
+    sim.setRecorder(&recorder);
+    if (settings.trajectories != TrajectoryMode::None) {
+        sim.recordTrajectories(settings.trajectories == TrajectoryMode::Sample ? params.trajectoryBudget : 0, params.trajectoryRate);
+    }
+    phase.switchTo(LiveMetrics::Simulate);
+    sim.run(settings.duration);
+    phase.switchTo(LiveMetrics::Record);
+    if (!settings.savePopulation.empty()) {
+        sim.saveSnapshot(settings.savePopulation, settings.duration);
+    }
+    RunSummary summary = summarizeRun(recorder);
+    summary.memory = sim.ledger;
+    summary.trajectories = std::move(sim.trajectories.getStore());
+    return summary;
+}
+
+RunSummary runCohortReplicate(const SweepSettings& settings, const SweepCell& cell, RunRecorder& recorder) {
+    PhaseTimer phase(liveMetrics, LiveMetrics::Setup);
+    CohortSim sim(readSwampParams(settings.configFile, cell.overrides), settings.snails, cell.reproProb, cell.predProb);
+    sim.setRecorder(&recorder);
+    phase.switchTo(LiveMetrics::Simulate);
+    sim.run(settings.duration);
+    phase.switchTo(LiveMetrics::Record);
+    RunSummary summary = summarizeRun(recorder);
+    summary.memory = sim.ledger;
+    return summary;
+}
+
+RunSummary runReplicate(const SweepSettings& settings, const SweepCell& cell, RunRecorder& recorder) {
+    auto start = std::chrono::steady_clock::now();
+    RunSummary summary;
+    switch (settings.engine) {
+        case Engine::Population: summary = runPopulationReplicate(settings, cell, recorder); break;
+        case Engine::Cohort: summary = runCohortReplicate(settings, cell, recorder); break;
+        default: summary = runObjectReplicate(settings, cell, recorder); break;
+    }
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return summary;
+}
+
+// Per tick series of every replicate a process runs, one row per tick with the
+// food and snail count of each region. The file is made when the first run arrives,
+// since that is when the number of regions is known.
+class SeriesWriter {
+private:
+    std::string path;
+    std::unique_ptr<ArrowFileWriter> file;
+
+public:
+    explicit SeriesWriter(const std::string& pPath) : path(pPath) {}
+
+    // before the first run only
+    void setPath(const std::string& pPath) { path = pPath; }
+
+    void add(int reproProb, int predProb, int replicate, const std::vector<RegionsData>& data) {
+        if (data.empty()) return;
+        if (!file) {
+            std::vector<ArrowFileWriter::Field> fields = {{"reproProb", ArrowFileWriter::Type::Int32},
+                                                          {"predProb", ArrowFileWriter::Type::Int32},
+                                                          {"replicate", ArrowFileWriter::Type::Int32},
+                                                          {"tick", ArrowFileWriter::Type::Int32},
+                                                          {"totalPop", ArrowFileWriter::Type::Int32}};
+            for (size_t r = 0; r < data[0].regions.size(); r++) {
+                fields.push_back({"region" + std::to_string(r) + "Food", ArrowFileWriter::Type::Int32});
+                fields.push_back({"region" + std::to_string(r) + "Snails", ArrowFileWriter::Type::Int32});
+            }
+            file.reset(new ArrowFileWriter(path, fields));
+        }
+        for (const RegionsData& entry : data) {
+            file->put(reproProb);
+            file->put(predProb);
+            file->put(replicate);
+            file->put(entry.time);
+            file->put(entry.totalPop);
+            for (const RegionData& region : entry.regions) {
+                file->put(region.foodLevel);
+                file->put(region.numOfSnails);
+            }
+        }
+    }
+    void close() {
+        if (file) file->close();
+    }
+    size_t bytes() const { return file ? file->bytes() : 0; }
+};
+
+// Window summaries of every replicate a process runs, one row per window: its first
+// and last tick and length, then the min, max, mean and last of the total population
+// and of each region's food and snails. Made by the first window, like the series.
+class WindowWriter {
+private:
+    std::string path;
+    std::unique_ptr<ArrowFileWriter> file;
+
+public:
+    explicit WindowWriter(const std::string& pPath) : path(pPath) {}
+
+    // before the first run only
+    void setPath(const std::string& pPath) { path = pPath; }
+
+    void add(int reproProb, int predProb, int replicate, const WindowAggregator& windows) {
+        if (!file) {
+            std::vector<ArrowFileWriter::Field> fields = {{"reproProb", ArrowFileWriter::Type::Int32},
+                                                          {"predProb", ArrowFileWriter::Type::Int32},
+                                                          {"replicate", ArrowFileWriter::Type::Int32},
+                                                          {"firstTick", ArrowFileWriter::Type::Int32},
+                                                          {"lastTick", ArrowFileWriter::Type::Int32},
+                                                          {"ticks", ArrowFileWriter::Type::Int32}};
+            std::vector<std::string> names = {"totalPop"};
+            for (size_t r = 0; r < (windows.size() - 1) / 2; r++) {
+                names.push_back("region" + std::to_string(r) + "Food");
+                names.push_back("region" + std::to_string(r) + "Snails");
+            }
+            for (const std::string& name : names) {
+                fields.push_back({name + "Min", ArrowFileWriter::Type::Int32});
+                fields.push_back({name + "Max", ArrowFileWriter::Type::Int32});
+                fields.push_back({name + "Mean", ArrowFileWriter::Type::Float64});
+                fields.push_back({name + "Last", ArrowFileWriter::Type::Int32});
+            }
+            file.reset(new ArrowFileWriter(path, fields));
+        }
+        file->put(reproProb);
+        file->put(predProb);
+        file->put(replicate);
+        file->put(windows.windowFirstTick());
+        file->put(windows.windowLastTick());
+        file->put(static_cast<int>(windows.windowTicks()));
+        for (size_t s = 0; s < windows.size(); s++) {
+            const WindowAggregator::Stats& stats = windows.windowStats(s);
+            file->put(static_cast<int>(stats.min));
+            file->put(static_cast<int>(stats.max));
+            file->put(stats.mean);
+            file->put(static_cast<int>(stats.last));
+        }
+    }
+    void close() {
+        if (file) file->close();
+    }
+    size_t bytes() const { return file ? file->bytes() : 0; }
+};
+
+// Heatmaps of every replicate a process runs, as they close. The file is "SNAILHMP",
+// then per heatmap ten little endian int32s, reproProb, predProb, replicate, first
+// and last tick, the grid's minX and minY, cell size, columns and rows, followed by
+// columns * rows uint32 snail-ticks, row major from minY. A reader can map the file
+// and step from heatmap to heatmap.
+class HeatmapWriter {
+private:
+    std::string path;
+    AsyncOfstream file; // opened by the first heatmap
+
+public:
+    explicit HeatmapWriter(const std::string& pPath) : path(pPath) {}
+
+    // before the first run only
+    void setPath(const std::string& pPath) { path = pPath; }
+
+    void add(int reproProb, int predProb, int replicate, const DensityHeatmap& heatmap) {
+        if (!file.is_open()) {
+            file.open(path);
+            if (!file.is_open()) {
+                throw std::runtime_error("Failed to open heatmap file: " + path);
+            }
+            file.write("SNAILHMP", 8);
+        }
+        int32_t header[10] = {reproProb, predProb, replicate, heatmap.windowFirstTick(), heatmap.windowLastTick(),
+                              heatmap.getMinX(), heatmap.getMinY(), heatmap.getCellSize(), heatmap.getColumns(), heatmap.getRows()};
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        const std::vector<uint32_t>& counts = heatmap.getCounts();
+        file.write(reinterpret_cast<const char*>(counts.data()), static_cast<std::streamsize>(counts.size() * sizeof(uint32_t)));
+        if (!file) {
+            throw std::runtime_error("Failed to write heatmap file: " + path);
+        }
+    }
+    void close() {
+        if (!file.is_open()) return;
+        file.close();
+        if (!file) {
+            throw std::runtime_error("Failed to write heatmap file: " + path);
+        }
+    }
+    size_t bytes() const { return file.bytes(); }
+};
+
+// What is kept of each single run rather than each cell: the per tick series, its
+// window summaries, the heatmaps and the trajectories. Every process writes the runs it did to files of its own. The
+// trajectory file is "SNAILTRJ", then per run its reproProb, predProb and replicate as
+// varints followed by the run's TrajectoryStore.
+class RunOutput {
+private:
+    std::unique_ptr<SeriesWriter> series;
+    std::unique_ptr<WindowWriter> windows;
+    int windowTicks = 0;
+    int windowStep = 0;
+    std::unique_ptr<HeatmapWriter> heatmaps;
+    int heatmapCell = 0;
+    int heatmapTicks = 0;
+    std::string trajectoryPath; // empty when trajectories are off
+    AsyncOfstream trajectoryFile; // opened by the first run
+
+public:
+    void enableSeries(const std::string& path) { series.reset(new SeriesWriter(path)); }
+    void enableWindows(const std::string& path, int ticks, int step) {
+        windows.reset(new WindowWriter(path));
+        windowTicks = ticks;
+        windowStep = step;
+    }
+    void enableHeatmaps(const std::string& path, int cellSize, int ticks) {
+        heatmaps.reset(new HeatmapWriter(path));
+        heatmapCell = cellSize;
+        heatmapTicks = ticks;
+    }
+    void enableTrajectories(const std::string& path) { trajectoryPath = path; }
+    bool enabled() const { return series || windows || heatmaps || !trajectoryPath.empty(); }
+
+    // this process's own file names, before the first run; only the enabled outputs change
+    void setPaths(const std::string& seriesPath, const std::string& windowPath, const std::string& heatmapPath, const std::string& pTrajectoryPath) {
+        if (series) series->setPath(seriesPath);
+        if (windows) windows->setPath(windowPath);
+        if (heatmaps) heatmaps->setPath(heatmapPath);
+        if (!trajectoryPath.empty()) trajectoryPath = pTrajectoryPath;
+    }
+
+    // what a replicate keeps while it runs: the series if it is written, and windows
+    // that go straight to their file as they close
+    RunRecorder recorder(int reproProb, int predProb, int replicate) {
+        RunRecorder recorder(series != nullptr);
+        if (windows) {
+            WindowWriter* out = windows.get();
+            recorder.setWindows(windowTicks, windowStep, [out, reproProb, predProb, replicate](const WindowAggregator& closed) {
+                out->add(reproProb, predProb, replicate, closed);
+            });
+        }
+        if (heatmaps) {
+            HeatmapWriter* out = heatmaps.get();
+            recorder.setHeatmaps(heatmapCell, heatmapTicks, [out, reproProb, predProb, replicate](const DensityHeatmap& closed) {
+                out->add(reproProb, predProb, replicate, closed);
+            });
+        }
+        return recorder;
+    }
+
+    void add(int reproProb, int predProb, int replicate, const RunSummary& run) {
+        if (series) {
+            series->add(reproProb, predProb, replicate, run.series);
+        }
+        if (trajectoryPath.empty()) return;
+        if (!trajectoryFile.is_open()) {
+            trajectoryFile.open(trajectoryPath);
+            if (!trajectoryFile.is_open()) {
+                throw std::runtime_error("Failed to open trajectory file: " + trajectoryPath);
+            }
+            trajectoryFile.write("SNAILTRJ", 8);
+        }
+        putVarint(trajectoryFile, zigzag(reproProb));
+        putVarint(trajectoryFile, zigzag(predProb));
+        putVarint(trajectoryFile, static_cast<uint64_t>(replicate));
+        run.trajectories.write(trajectoryFile);
+        if (!trajectoryFile) {
+            throw std::runtime_error("Failed to write trajectory file: " + trajectoryPath);
+        }
+    }
+    void close() {
+        if (series) series->close();
+        if (windows) windows->close();
+        if (heatmaps) heatmaps->close();
+        if (trajectoryFile.is_open()) {
+            trajectoryFile.close();
+            if (!trajectoryFile) {
+                throw std::runtime_error("Failed to write trajectory file: " + trajectoryPath);
+            }
+        }
+    }
+    size_t bytes() const {
+        return (series ? series->bytes() : 0) + (windows ? windows->bytes() : 0) + (heatmaps ? heatmaps->bytes() : 0) + trajectoryFile.bytes();
+    }
+};
+
+class CSVWriter {
+private:
+    std::string csvFilePath_;
+    std::string posFilePath;
+    // Opened by the first row and kept open. Each row is handed to the file's writer
+    // thread as soon as it is made, so a crash loses at most the rows still queued.
+    AsyncOfstream mainFile{64 << 10, 8};
+public:
+    CSVWriter(const std::string& csvFilePath, const std::string& posFilePath)
+        : csvFilePath_(csvFilePath), posFilePath(posFilePath) {}
+
+    void createCSV(const CellResult& result) {
+        if (!mainFile.is_open()) {
+            // Check if CSV file exists
+            bool csvExists = false;
+            {
+                std::ifstream checkCsv(csvFilePath_);
+                csvExists = checkCsv.good();
+            }
+            mainFile.open(csvFilePath_, true);
+            if (!mainFile.is_open()) {
+                throw std::runtime_error("Failed to open CSV file: " + csvFilePath_);
+            }
+            if (!csvExists) {
+                mainFile << "PredProb, ReproProb, Time, Number Of Snails, Replicates, Time SD, Time CI, Number Of Snails SD, Number Of Snails CI";
+                for (const auto& entry : result.overrides) mainFile << ", " << entry.first; // the other swept parameters
+                mainFile << "\n";
+            }
+        }
+        // Time and Number Of Snails are replicate means of the peak
+        mainFile << result.predProb << "," << result.reproProb << ","
+                 << result.peakTime.mean << "," << result.peakPop.mean << ","
+                 << result.peakPop.count << ","
+                 << result.peakTime.stdDev() << "," << result.peakTime.halfWidth() << ","
+                 << result.peakPop.stdDev() << "," << result.peakPop.halfWidth();
+        for (const auto& entry : result.overrides) mainFile << "," << entry.second;
+        mainFile << "\n";
+        mainFile.flush();
+        if (!mainFile) {
+            throw std::runtime_error("Failed to write CSV file: " + csvFilePath_);
+        }
+    }
+    void close() {
+        if (!mainFile.is_open()) return;
+        mainFile.close();
+        if (!mainFile) {
+            throw std::runtime_error("Failed to write CSV file: " + csvFilePath_);
+        }
+    }
+    size_t bytes() const { return mainFile.bytes(); }
+};
+
+// Per cell and sweep level memory figures. A cell's figures are the high water
+// over its replicates; the sweep keeps the high water over all cells.
+class MemoryReport {
+private:
+    MemoryReportMode mode;
+    std::string jsonFilePath;
+    json cellsJson = json::array();
+
+    static json ledgerJson(const MemoryLedger& ledger) {
+        json j;
+        for (int i = 0; i < MEMORY_CATEGORIES; i++) {
+            j[memoryCategoryName(i)] = {{"current", ledger.getCurrent(i)}, {"peak", ledger.getPeak(i)}};
+        }
+        j["totalPeak"] = ledger.getTotalPeak();
+        return j;
+    }
+
+public:
+    MemoryReport(MemoryReportMode pMode, const std::string& pJsonFilePath)
+        : mode(pMode), jsonFilePath(pJsonFilePath) {}
+
+    void addCell(const CellResult& result) {
+        if (mode == MemoryReportMode::Text) {
+            std::cout << "Memory reproProb " << result.reproProb << " predProb " << result.predProb;
+            for (const auto& entry : result.overrides) std::cout << " " << entry.first << " " << entry.second;
+            std::cout << ":";
+            for (int i = 0; i < MEMORY_CATEGORIES; i++) {
+                std::cout << " " << memoryCategoryName(i) << " " << result.memory.getPeak(i);
+            }
+            std::cout << " total " << result.memory.getTotalPeak() << " bytes peak\n";
+        } else if (mode == MemoryReportMode::Json) {
+            json cell = ledgerJson(result.memory);
+            cell["reproProb"] = result.reproProb;
+            cell["predProb"] = result.predProb;
+            for (const auto& entry : result.overrides) cell[entry.first] = entry.second;
+            cell["replicates"] = result.peakPop.count;
+            cellsJson.push_back(cell);
+        }
+    }
+
+    void finish(const MemoryLedger& sweep, size_t sweepPeakRss) {
+        std::cout << "Memory: " << sweep.getTotalPeak() << " bytes peak per run (";
+        for (int i = 0; i < MEMORY_CATEGORIES; i++) {
+            std::cout << (i ? ", " : "") << memoryCategoryName(i) << " " << sweep.getPeak(i);
+        }
+        std::cout << "), peak RSS " << sweepPeakRss << " bytes\n";
+        if (mode != MemoryReportMode::Json) {
+            return;
+        }
+        json j;
+        j["cells"] = cellsJson;
+        j["sweep"] = ledgerJson(sweep);
+        j["sweep"]["peakRss"] = sweepPeakRss;
+        std::ofstream file(jsonFilePath);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open memory report: " + jsonFilePath);
+        }
+        file << j.dump(2) << "\n";
+    }
+};
+
+// The sweep's rows as Arrow, beside the CSV, with a column after the others for
+// each parameter swept besides the probabilities
+class ResultsWriter {
+private:
+    ArrowFileWriter file;
+
+    static std::vector<ArrowFileWriter::Field> fields(const ConfigOverrides& overrides) {
+        std::vector<ArrowFileWriter::Field> all = {{"predProb", ArrowFileWriter::Type::Int32},
+                                                   {"reproProb", ArrowFileWriter::Type::Int32},
+                                                   {"peakTime", ArrowFileWriter::Type::Float64},
+                                                   {"peakPop", ArrowFileWriter::Type::Float64},
+                                                   {"replicates", ArrowFileWriter::Type::Int32},
+                                                   {"peakTimeSD", ArrowFileWriter::Type::Float64},
+                                                   {"peakTimeCI", ArrowFileWriter::Type::Float64},
+                                                   {"peakPopSD", ArrowFileWriter::Type::Float64},
+                                                   {"peakPopCI", ArrowFileWriter::Type::Float64},
+                                                   {"snailTicks", ArrowFileWriter::Type::Int64},
+                                                   {"seconds", ArrowFileWriter::Type::Float64},
+                                                   {"memoryPeak", ArrowFileWriter::Type::Int64},
+                                                   {"peakRss", ArrowFileWriter::Type::Int64}};
+        for (const auto& entry : overrides) all.push_back({entry.first, ArrowFileWriter::Type::Int32});
+        return all;
+    }
+
+public:
+    // the overrides of any cell, for their names
+    ResultsWriter(const std::string& path, const ConfigOverrides& overrides) : file(path, fields(overrides)) {}
+
+    void addCell(const CellResult& result) {
+        file.put(result.predProb);
+        file.put(result.reproProb);
+        file.put(result.peakTime.mean);
+        file.put(result.peakPop.mean);
+        file.put(result.peakPop.count);
+        file.put(result.peakTime.stdDev());
+        file.put(result.peakTime.halfWidth());
+        file.put(result.peakPop.stdDev());
+        file.put(result.peakPop.halfWidth());
+        file.put(result.throughput.snailTicks);
+        file.put(result.throughput.seconds);
+        file.put(static_cast<long long>(result.memory.getTotalPeak()));
+        file.put(static_cast<long long>(result.peakRss));
+        for (const auto& entry : result.overrides) file.put(entry.second);
+    }
+    void close() { file.close(); }
+    size_t bytes() const { return file.bytes(); }
+};
+
+// The whole sweep as a dense matrix over the sweep's axes, filled a cell at a time
+// and written once at the end. The binary file is "SNAILMAT", the header length as a
+// little endian uint64 and a JSON header with the axes and fields, padded so the data
+// starts on a 64 byte boundary. The data is one float64 array per field, shaped like
+// the axes in their order, with NaN for cells that did not run: a cell's offset in
+// the array is its index in the sweep table. A plot maps the file and takes the
+// arrays where they lie.
+class ResultsMatrix {
+private:
+    MatrixOutput mode;
+    std::string path; // the binary file, or the CSVs' prefix
+    std::vector<SweepTable::Axis> axes;
+    size_t numCells;
+    std::vector<double> values; // field, cell
+    size_t filled = 0;
+
+    static const std::vector<std::string>& fieldNames() {
+        static const std::vector<std::string> names = {"peakPop", "peakPopSD", "peakPopCI", "peakTime", "peakTimeSD", "peakTimeCI",
+                                                       "replicates", "extinctions", "extinctionTick", "snailTicks", "seconds"};
+        return names;
+    }
+    static void writeAll(const std::string& filePath, const std::string& contents) {
+        std::ofstream file(filePath, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open matrix file: " + filePath);
+        }
+        file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        if (!file) {
+            throw std::runtime_error("Failed to write matrix file: " + filePath);
+        }
+    }
+
+    void writeBinary() const {
+        json header;
+        header["axes"] = json::array();
+        std::vector<size_t> shape = {fieldNames().size()};
+        for (const SweepTable::Axis& axis : axes) {
+            header["axes"].push_back({{"name", axis.name}, {"values", axis.values}});
+            shape.push_back(axis.values.size());
+        }
+        header["fields"] = fieldNames();
+        header["dtype"] = "<f8";
+        header["shape"] = shape;
+        std::string text = header.dump();
+        size_t dataOffset = (16 + text.size() + 1 + 63) / 64 * 64;
+        text.resize(dataOffset - 16 - 1, ' ');
+        text += '\n';
+        uint64_t headerLength = text.size();
+        std::string contents("SNAILMAT", 8);
+        contents.append(reinterpret_cast<const char*>(&headerLength), sizeof(headerLength));
+        contents += text;
+        contents.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+        writeAll(path, contents);
+    }
+    // the last axis across, a row for every combination of the others
+    void writeCsv() const {
+        const SweepTable::Axis& across = axes.back();
+        for (size_t f = 0; f < fieldNames().size(); f++) {
+            std::ostringstream table;
+            table.precision(17);
+            for (size_t a = 0; a + 1 < axes.size(); a++) {
+                table << axes[a].name << (a + 2 < axes.size() ? "," : "/");
+            }
+            table << across.name;
+            for (int value : across.values) table << "," << value;
+            table << "\n";
+            for (size_t row = 0; row < numCells / across.values.size(); row++) {
+                size_t rest = row;
+                std::vector<int> labels(axes.size() - 1);
+                for (size_t a = axes.size() - 1; a-- > 0;) {
+                    labels[a] = axes[a].values[rest % axes[a].values.size()];
+                    rest /= axes[a].values.size();
+                }
+                for (size_t a = 0; a < labels.size(); a++) table << (a ? "," : "") << labels[a];
+                for (size_t c = 0; c < across.values.size(); c++) {
+                    double value = values[f * numCells + row * across.values.size() + c];
+                    table << ",";
+                    if (!std::isnan(value)) table << value;
+                }
+                table << "\n";
+            }
+            writeAll(path + "." + fieldNames()[f] + ".csv", table.str());
+        }
+    }
+
+public:
+    ResultsMatrix(MatrixOutput pMode, const std::string& pPath, const SweepTable& table)
+        : mode(pMode), path(pPath), axes(table.getAxes()), numCells(table.size()) {
+        values.assign(fieldNames().size() * numCells, std::numeric_limits<double>::quiet_NaN());
+    }
+
+    void addCell(const CellResult& result) {
+        if (result.cell >= numCells) {
+            throw std::runtime_error("Cell outside the results matrix");
+        }
+        const RunningStats& extinct = result.extinctionTick;
+        double cell[] = {result.peakPop.mean, result.peakPop.stdDev(), result.peakPop.halfWidth(),
+                         result.peakTime.mean, result.peakTime.stdDev(), result.peakTime.halfWidth(),
+                         static_cast<double>(result.peakPop.count),
+                         result.peakPop.count > 0 ? static_cast<double>(extinct.count) / result.peakPop.count : 0.0,
+                         extinct.count > 0 ? extinct.mean : std::numeric_limits<double>::quiet_NaN(),
+                         static_cast<double>(result.throughput.snailTicks), result.throughput.seconds};
+        for (size_t f = 0; f < fieldNames().size(); f++) {
+            values[f * numCells + result.cell] = cell[f];
+        }
+        filled++;
+    }
+    // queue workers that merge nothing leave the merger's file alone
+    void write() const {
+        if (filled == 0) return;
+        if (mode == MatrixOutput::Binary) {
+            writeBinary();
+        } else if (mode == MatrixOutput::Csv) {
+            writeCsv();
+        }
+    }
+    size_t bytes() const { return vectorBytes(values); }
+};
+
+// everything produced by the sweep goes through here, one finished cell at a time
+class SweepOutput {
+private:
+    CSVWriter csvWriter;
+    MemoryReport memoryReport;
+    std::string arrowPath; // empty without Arrow output
+    std::unique_ptr<ResultsWriter> arrowResults; // made by the first row, so workers that write none leave no file
+    std::unique_ptr<ResultsMatrix> matrix;
+    RunOutput runs;
+
+public:
+    SweepOutput(const std::string& csvFilePath, const std::string& posFilePath, MemoryReportMode memoryMode)
+        : csvWriter(csvFilePath, posFilePath), memoryReport(memoryMode, "snail2_memory.json") {}
+
+    void enableArrow(const std::string& resultsPath, const std::string& seriesPath) {
+        arrowPath = resultsPath;
+        if (!seriesPath.empty()) {
+            runs.enableSeries(seriesPath);
+        }
+    }
+    void enableMatrix(MatrixOutput mode, const std::string& path, const SweepTable& table) {
+        matrix.reset(new ResultsMatrix(mode, path, table));
+    }
+    void enableWindows(const std::string& path, int ticks, int step) { runs.enableWindows(path, ticks, step); }
+    void enableHeatmaps(const std::string& path, int cellSize, int ticks) { runs.enableHeatmaps(path, cellSize, ticks); }
+    void enableTrajectories(const std::string& path) { runs.enableTrajectories(path); }
+    // where this process's runs go, or null if nothing is kept of them
+    RunOutput* getRuns() { return runs.enabled() ? &runs : nullptr; }
+
+    Throughput throughput;
+    MemoryLedger memory;
+    size_t peakRss = 0;
+
+    void addCell(const CellResult& result) {
+        write(result);
+        tally(result);
+    }
+    // the cell's row in the CSV and memory report
+    void write(const CellResult& result) {
+        PhaseTimer phase(liveMetrics, LiveMetrics::Write);
+        csvWriter.createCSV(result);
+        memoryReport.addCell(result);
+        if (!arrowPath.empty()) {
+            if (!arrowResults) arrowResults.reset(new ResultsWriter(arrowPath, result.overrides));
+            arrowResults->addCell(result);
+        }
+        if (matrix) matrix->addCell(result);
+    }
+    // the cell's share of the throughput and high water figures
+    void tally(const CellResult& result) {
+        throughput.add(result.throughput.snailTicks, result.throughput.seconds);
+        memory.merge(result.memory);
+        peakRss = std::max(peakRss, result.peakRss);
+    }
+    void finish() {
+        csvWriter.close();
+        memoryReport.finish(memory, std::max(peakRss, ::peakRss()));
+        if (arrowResults) arrowResults->close();
+        if (matrix) matrix->write();
+        runs.close();
+    }
+    // every writer's buffers and the matrix, what the output holds in memory
+    size_t bytes() const {
+        return csvWriter.bytes() + (arrowResults ? arrowResults->bytes() : 0) + (matrix ? matrix->bytes() : 0) + runs.bytes();
+    }
+};
+
+// keeps adding replicates until both peaks are pinned down or the cap is hit
+CellResult runCell(const SweepSettings& settings, const SweepCell& cell, SweepOutput& output) {
+    RunOutput* runs = output.getRuns();
+    const ReplicateOptions& options = settings.replicates;
+    CellResult result{cell.reproProb, cell.predProb, cell.index, cell.overrides};
+    while (result.peakPop.count < options.maxReplicates) {
+        RunRecorder recorder = runs ? runs->recorder(cell.reproProb, cell.predProb, result.peakPop.count) : RunRecorder();
+        RunSummary summary = runReplicate(settings, cell, recorder);
+        liveMetrics.replicates.fetch_add(1, std::memory_order_relaxed);
+        if (runs) {
+            PhaseTimer phase(liveMetrics, LiveMetrics::Record);
+            runs->add(cell.reproProb, cell.predProb, result.peakPop.count, summary);
+        }
+        summary.memory.set(MemoryCategory::OutputBuffers, output.bytes()); // the writers' buffers, once this run is in them
+        result.peakPop.add(summary.peakPop);
+        result.peakTime.add(summary.peakTime);
+        if (summary.extinctionTick >= 0) {
+            result.extinctionTick.add(summary.extinctionTick);
+        }
+        result.throughput.add(summary.snailTicks, summary.seconds);
+        result.memory.merge(summary.memory);
+        if (result.peakPop.count >= options.minReplicates && result.converged(options.ciTarget)) {
+            break;
+        }
+    }
+    result.peakRss = peakRss();
+    liveMetrics.cellsRun.fetch_add(1, std::memory_order_relaxed);
+    return result;
+}
+
+// One axis of a sweep spec: "value": n, "values": [...], a range "start", "stop"
+// (exclusive), "step" (1 unless given), or "count" draws from "uniform": [lo, hi] or
+// "normal": [mean, sd], rounded, from a generator seeded with "seed" so that every
+// worker draws the same values.
+SweepTable::Axis readSweepAxis(const json& spec) {
+    SweepTable::Axis axis{spec.at("name").get<std::string>(), {}};
+    int forms = spec.contains("value") + spec.contains("values") + spec.contains("start") + spec.contains("uniform") + spec.contains("normal");
+    if (forms != 1) {
+        throw std::runtime_error("Sweep parameter " + axis.name + " needs exactly one of value, values, start, uniform or normal");
+    }
+    if (spec.contains("value")) {
+        axis.values.push_back(spec["value"].get<int>());
+    } else if (spec.contains("values")) {
+        axis.values = spec["values"].get<std::vector<int>>();
+    } else if (spec.contains("start")) {
+        int step = spec.value("step", 1);
+        if (step <= 0) {
+            throw std::runtime_error("Sweep parameter " + axis.name + " needs a positive step");
+        }
+        for (long long value = spec["start"].get<int>(); value < spec.at("stop").get<int>(); value += step) {
+            axis.values.push_back(static_cast<int>(value));
+        }
+    } else {
+        int count = spec.at("count").get<int>();
+        if (count <= 0) {
+            throw std::runtime_error("Sweep parameter " + axis.name + " needs a positive count");
+        }
+        std::mt19937 draws(spec.value("seed", 1u));
+        std::vector<double> bounds = spec.contains("uniform") ? spec["uniform"].get<std::vector<double>>() : spec["normal"].get<std::vector<double>>();
+        if (bounds.size() != 2) {
+            throw std::runtime_error("Sweep parameter " + axis.name + " needs two values for its distribution");
+        }
+        for (int k = 0; k < count; k++) {
+            double value = spec.contains("uniform") ? std::uniform_real_distribution<double>(bounds[0], bounds[1])(draws)
+                                                    : std::normal_distribution<double>(bounds[0], bounds[1])(draws);
+            axis.values.push_back(static_cast<int>(std::lround(value)));
+        }
+    }
+    return axis;
+}
+
+// The sweep spec, {"parameters": [axis, ...]}, compiled once at startup. Besides
+// reproProb and predProb a parameter is any number at the top level of the config,
+// which each cell overrides. Parameters left out keep the config's value, and
+// --repro-prob / --pred-prob pin theirs to one.
+SweepTable compileSweep(const SweepSettings& settings) {
+    json config = readConfigJson(settings.configFile);
+    std::ifstream file(settings.sweepFile);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open sweep spec: " + settings.sweepFile);
+    }
+    json spec;
+    file >> spec;
+    std::vector<SweepTable::Axis> axes;
+    for (const json& parameter : spec.at("parameters")) {
+        axes.push_back(readSweepAxis(parameter));
+        const std::string& name = axes.back().name;
+        if (name != "reproProb" && name != "predProb" && !(config.contains(name) && config[name].is_number())) {
+            throw std::runtime_error("Sweep parameter " + name + " is not a number in " + settings.configFile);
+        }
+    }
+    for (const auto& pin : {std::make_pair(std::string("reproProb"), settings.reproProb), std::make_pair(std::string("predProb"), settings.predProb)}) {
+        auto axis = std::find_if(axes.begin(), axes.end(), [&](const SweepTable::Axis& a) { return a.name == pin.first; });
+        if (axis == axes.end()) {
+            axes.push_back(SweepTable::Axis{pin.first, {pin.second != 0 ? pin.second : config.at(pin.first).get<int>()}});
+        } else if (pin.second != 0) {
+            axis->values = {pin.second};
+        }
+    }
+    return SweepTable(std::move(axes));
+}
+
+void runSweep(const SweepTable& table, const SweepSettings& settings, SweepOutput& output) {
+    liveMetrics.cellsTotal.store(static_cast<long long>(table.size()));
+    for (size_t i = 0; i < table.size(); i++) {
+        output.addCell(runCell(settings, table.cell(i), output));
+        liveMetrics.cellsDone.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// compact result record, sent back to rank 0 or kept in a queue shard: cell index, count, mean/m2 of both peaks,
+// throughput, extinctions and their mean/m2, memory high water per category, total and the worker's peak RSS
+const int RECORD_MEMORY = 11;
+const int RECORD_SIZE = RECORD_MEMORY + MEMORY_CATEGORIES + 2;
+
+void packRecord(int cellIndex, const CellResult& result, double* record) {
+    record[0] = cellIndex;
+    record[1] = result.peakPop.count;
+    record[2] = result.peakPop.mean;
+    record[3] = result.peakPop.m2;
+    record[4] = result.peakTime.mean;
+    record[5] = result.peakTime.m2;
+    record[6] = static_cast<double>(result.throughput.snailTicks);
+    record[7] = result.throughput.seconds;
+    record[8] = result.extinctionTick.count;
+    record[9] = result.extinctionTick.mean;
+    record[10] = result.extinctionTick.m2;
+    for (int i = 0; i < MEMORY_CATEGORIES; i++) {
+        record[RECORD_MEMORY + i] = static_cast<double>(result.memory.getPeak(i));
+    }
+    record[RECORD_MEMORY + MEMORY_CATEGORIES] = static_cast<double>(result.memory.getTotalPeak());
+    record[RECORD_MEMORY + MEMORY_CATEGORIES + 1] = static_cast<double>(result.peakRss);
+}
+
+CellResult unpackRecord(const double* record, const SweepCell& cell) {
+    int count = static_cast<int>(record[1]);
+    CellResult result{cell.reproProb, cell.predProb, cell.index, cell.overrides,
+                      RunningStats{count, record[2], record[3]},
+                      RunningStats{count, record[4], record[5]},
+                      RunningStats{static_cast<int>(record[8]), record[9], record[10]},
+                      Throughput{static_cast<long long>(record[6]), record[7]},
+                      MemoryLedger{},
+                      static_cast<size_t>(record[RECORD_MEMORY + MEMORY_CATEGORIES + 1])};
+    for (int i = 0; i < MEMORY_CATEGORIES; i++) {
+        result.memory.setPeak(i, static_cast<size_t>(record[RECORD_MEMORY + i]));
+    }
+    result.memory.setTotalPeak(static_cast<size_t>(record[RECORD_MEMORY + MEMORY_CATEGORIES]));
+    return result;
+}
+
+// what every worker on a queue has to agree on: everything that changes a cell's
+// result or what is written for it. The config goes in by content, as the path may
+// differ between machines; threads are left out, a seeded run is the same on any number.
+std::string sweepManifest(const SweepTable& table, const SweepSettings& settings) {
+    json j;
+    j["snails"] = settings.snails;
+    j["duration"] = settings.duration;
+    j["engine"] = static_cast<int>(settings.engine);
+    j["config"] = readConfigJson(settings.configFile);
+    j["population"] = settings.populationFile;
+    j["minReplicates"] = settings.replicates.minReplicates;
+    j["maxReplicates"] = settings.replicates.maxReplicates;
+    j["ciTarget"] = settings.replicates.ciTarget;
+    j["reproProb"] = settings.reproProb;
+    j["predProb"] = settings.predProb;
+    j["seed"] = settings.seed;
+    j["memoryReport"] = static_cast<int>(settings.memoryReport);
+    j["arrow"] = static_cast<int>(settings.arrow);
+    j["matrix"] = static_cast<int>(settings.matrix);
+    j["trajectories"] = static_cast<int>(settings.trajectories);
+    j["windowTicks"] = settings.windowTicks;
+    j["windowStep"] = settings.windowStep;
+    j["heatmapCell"] = settings.heatmapCell;
+    j["heatmapTicks"] = settings.heatmapTicks;
+    j["cells"] = table.size();
+    j["axes"] = table.toJson();
+    return j.dump();
+}
+
+// host and process, unique among the workers of a sweep
+std::string workerName() {
+    char host[256] = "host";
+    gethostname(host, sizeof(host) - 1);
+    return std::string(host) + "-" + std::to_string(getpid());
+}
+
+// No coordinator: every worker claims cells from the shared directory, appends each
+// result to its own shard, and the worker that sees the queue drained merges the
+// shards in cell order. Each cell seeds the generator from its index, so with --seed
+// a cell gives the same result whichever worker runs it. Returns true for the merger.
+bool runSweepQueue(const SweepTable& table, SweepSettings settings, SweepOutput& output) {
+    std::string worker = workerName();
+    JobQueue queue(settings.queueDir, worker, settings.leaseSeconds);
+    if (output.getRuns()) { // one set of run files per worker, like the shards
+        std::filesystem::path runs = queue.getRoot() / "runs";
+        std::filesystem::create_directories(runs);
+        output.getRuns()->setPaths((runs / (worker + ".arrow")).string(), (runs / (worker + ".windows.arrow")).string(),
+                                   (runs / (worker + ".heatmaps")).string(), (runs / (worker + ".trajectories")).string());
+    }
+
+    std::string manifest = sweepManifest(table, settings);
+    std::vector<std::string> payloads; // the cell index is all a worker needs
+    for (size_t i = 0; i < table.size(); i++) {
+        payloads.push_back(std::to_string(i));
+    }
+    if (!queue.create(payloads, manifest)) {
+        std::string existing = queue.readManifest();
+        if (!settings.seedGiven) { // the time the first worker started
+            settings.seed = json::parse(existing).value("seed", settings.seed);
+            manifest = sweepManifest(table, settings);
+        }
+        if (existing != manifest) {
+            throw std::runtime_error("Job queue " + settings.queueDir + " belongs to a different sweep");
+        }
+    }
+    liveMetrics.cellsTotal.store(static_cast<long long>(table.size()));
+    liveMetrics.cellsDone.store(static_cast<long long>(table.size() - queue.pendingCount() - queue.leasedCount()));
+
+    JobQueue::Job job;
+    while (true) {
+        if (!queue.claim(job)) {
+            if (queue.finished()) break;
+            // the rest are leased; wait in case one of those workers has died
+            std::this_thread::sleep_for(std::chrono::duration<double>(std::min(5.0, settings.leaseSeconds / 4)));
+            continue;
+        }
+        SweepCell cell = table.cell(std::stoul(job.payload));
+        globalRng.reseed(mix64(settings.seed ^ mix64(job.index)));
+        CellResult result;
+        {
+            LeaseKeeper keeper(queue, job, settings.leaseSeconds / 4);
+            result = runCell(settings, cell, output);
+        }
+        double record[RECORD_SIZE];
+        packRecord(static_cast<int>(job.index), result, record);
+        std::ostringstream line;
+        line.precision(17);
+        for (int i = 0; i < RECORD_SIZE; i++) {
+            line << (i ? "," : "") << record[i];
+        }
+        line << "\n";
+        queue.appendResult(line.str()); // on the server before the job counts as done
+        queue.complete(job);
+        liveMetrics.cellsDone.store(static_cast<long long>(table.size() - queue.pendingCount() - queue.leasedCount()));
+        output.tally(result);
+    }
+    liveMetrics.cellsDone.store(static_cast<long long>(table.size())); // the queue has drained
+
+    if (!queue.lockMerge()) {
+        return false;
+    }
+    // a reclaimed cell can be finished twice, the first record wins
+    std::vector<std::vector<double>> records(table.size());
+    for (const std::filesystem::path& path : queue.shards()) {
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)) {
+            std::vector<double> record;
+            std::istringstream fields(line);
+            std::string field;
+            while (std::getline(fields, field, ',')) {
+                record.push_back(std::stod(field));
+            }
+            if (record.size() != static_cast<size_t>(RECORD_SIZE)) continue; // cut short by a crash
+            size_t index = static_cast<size_t>(record[0]);
+            if (index < records.size() && records[index].empty()) {
+                records[index] = record;
+            }
+        }
+    }
+    for (size_t i = 0; i < table.size(); i++) {
+        if (records[i].empty()) {
+            throw std::runtime_error("Job queue has no result for cell " + std::to_string(i));
+        }
+        output.write(unpackRecord(records[i].data(), table.cell(i)));
+    }
+    return true;
+}
+
+#ifdef SNAILSIM_MPI
+// Rank 0 deals cells out one at a time and is the only rank touching the CSV;
+// workers ask for the next cell by returning the result of the previous one.
+const int TAG_WORK = 1;
+const int TAG_RESULT = 2;
+const int TAG_STOP = 3;
+
+void runSweepMPI(const SweepTable& table, const SweepSettings& settings, SweepOutput& output) {
+    int rank = 0;
+    int size = 1;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    int numCells = static_cast<int>(table.size());
+    double record[RECORD_SIZE];
+
+    if (size == 1) { // nobody to hand work to
+        runSweep(table, settings, output);
+        return;
+    }
+
+    if (rank != 0) {
+        while (true) {
+            int cellIndex = 0;
+            MPI_Status status;
+            MPI_Recv(&cellIndex, 1, MPI_INT, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+            if (status.MPI_TAG == TAG_STOP) {
+                return;
+            }
+            CellResult result = runCell(settings, table.cell(cellIndex), output);
+            packRecord(cellIndex, result, record);
+            MPI_Send(record, RECORD_SIZE, MPI_DOUBLE, 0, TAG_RESULT, MPI_COMM_WORLD);
+        }
+    }
+
+    liveMetrics.cellsTotal.store(numCells);
+    int nextCell = 0;
+    int activeWorkers = 0;
+    for (int worker = 1; worker < size; worker++) {
+        if (nextCell < numCells) {
+            MPI_Send(&nextCell, 1, MPI_INT, worker, TAG_WORK, MPI_COMM_WORLD);
+            nextCell++;
+            activeWorkers++;
+        } else {
+            MPI_Send(&nextCell, 1, MPI_INT, worker, TAG_STOP, MPI_COMM_WORLD);
+        }
+    }
+
+    // results arrive out of order; rows are written as soon as the prefix before them is complete
+    std::vector<CellResult> results(numCells);
+    std::vector<bool> finished(numCells, false);
+    int nextToWrite = 0;
+    while (activeWorkers > 0) {
+        MPI_Status status;
+        MPI_Recv(record, RECORD_SIZE, MPI_DOUBLE, MPI_ANY_SOURCE, TAG_RESULT, MPI_COMM_WORLD, &status);
+        int cellIndex = static_cast<int>(record[0]);
+        results[cellIndex] = unpackRecord(record, table.cell(cellIndex));
+        finished[cellIndex] = true;
+        liveMetrics.cellsDone.fetch_add(1, std::memory_order_relaxed);
+
+        if (nextCell < numCells) {
+            MPI_Send(&nextCell, 1, MPI_INT, status.MPI_SOURCE, TAG_WORK, MPI_COMM_WORLD);
+            nextCell++;
+        } else {
+            MPI_Send(&nextCell, 1, MPI_INT, status.MPI_SOURCE, TAG_STOP, MPI_COMM_WORLD);
+            activeWorkers--;
+        }
+
+        while (nextToWrite < numCells && finished[nextToWrite]) {
+            output.addCell(results[nextToWrite]);
+            nextToWrite++;
+        }
+    }
+}
+#endif
+
+// optional flags after the positional arguments, which end before argv[first]
+bool parseOptions(int argc, char* argv[], int first, SweepSettings& settings) {
+    ReplicateOptions& options = settings.replicates;
+    for (int i = first; i < argc; i++) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << flag << "\n";
+            return false;
+        }
+        std::string value = argv[++i];
+        if (flag == "--min-replicates") {
+            options.minReplicates = std::stoi(value);
+        } else if (flag == "--max-replicates") {
+            options.maxReplicates = std::stoi(value);
+        } else if (flag == "--ci-target") {
+            options.ciTarget = std::stod(value);
+        } else if (flag == "--engine") {
+            if (value == "object") {
+                settings.engine = Engine::Object;
+            } else if (value == "population") {
+                settings.engine = Engine::Population;
+            } else if (value == "cohort") {
+                settings.engine = Engine::Cohort;
+            } else {
+                std::cerr << "Unknown engine " << value << "\n";
+                return false;
+            }
+        } else if (flag == "--memory-report") {
+            if (value == "none") {
+                settings.memoryReport = MemoryReportMode::None;
+            } else if (value == "text") {
+                settings.memoryReport = MemoryReportMode::Text;
+            } else if (value == "json") {
+                settings.memoryReport = MemoryReportMode::Json;
+            } else {
+                std::cerr << "Unknown memory report " << value << "\n";
+                return false;
+            }
+        } else if (flag == "--arrow") {
+            if (value == "none") {
+                settings.arrow = ArrowOutput::None;
+            } else if (value == "results") {
+                settings.arrow = ArrowOutput::Results;
+            } else if (value == "all") {
+                settings.arrow = ArrowOutput::All;
+            } else {
+                std::cerr << "Unknown Arrow output " << value << "\n";
+                return false;
+            }
+        } else if (flag == "--matrix") {
+            if (value == "none") {
+                settings.matrix = MatrixOutput::None;
+            } else if (value == "binary") {
+                settings.matrix = MatrixOutput::Binary;
+            } else if (value == "csv") {
+                settings.matrix = MatrixOutput::Csv;
+            } else {
+                std::cerr << "Unknown matrix output " << value << "\n";
+                return false;
+            }
+        } else if (flag == "--trajectories") {
+            if (value == "none") {
+                settings.trajectories = TrajectoryMode::None;
+            } else if (value == "all") {
+                settings.trajectories = TrajectoryMode::All;
+            } else if (value == "sample") {
+                settings.trajectories = TrajectoryMode::Sample;
+            } else {
+                std::cerr << "Unknown trajectories " << value << "\n";
+                return false;
+            }
+        } else if (flag == "--windows") {
+            settings.windowTicks = std::stoi(value);
+        } else if (flag == "--window-step") {
+            settings.windowStep = std::stoi(value);
+        } else if (flag == "--heatmap") {
+            settings.heatmapCell = std::stoi(value);
+        } else if (flag == "--heatmap-ticks") {
+            settings.heatmapTicks = std::stoi(value);
+        } else if (flag == "--repro-prob") {
+            settings.reproProb = std::stoi(value);
+        } else if (flag == "--pred-prob") {
+            settings.predProb = std::stoi(value);
+        } else if (flag == "--queue") {
+#ifdef SNAILSIM_MPI
+            std::cerr << "--queue is for the plain build, MPI already shares out the cells\n";
+            return false;
+#endif
+            settings.queueDir = value;
+        } else if (flag == "--lease-seconds") {
+            settings.leaseSeconds = std::stod(value);
+        } else if (flag == "--seed") {
+            settings.seed = std::stoull(value);
+            settings.seedGiven = true;
+        } else if (flag == "--threads") {
+            settings.threads = static_cast<unsigned>(std::stoi(value));
+        } else if (flag == "--config") {
+            settings.configFile = value;
+        } else if (flag == "--sweep") {
+            settings.sweepFile = value;
+        } else if (flag == "--metrics") {
+            settings.metricsPath = value;
+            settings.metricsSocket = false;
+        } else if (flag == "--metrics-socket") {
+            settings.metricsPath = value;
+            settings.metricsSocket = true;
+        } else if (flag == "--metrics-interval") {
+            settings.metricsInterval = std::stod(value);
+        } else if (flag == "--population") {
+            settings.populationFile = value;
+        } else if (flag == "--save-population") {
+            settings.savePopulation = value;
+        } else {
+            std::cerr << "Unknown option " << flag << "\n";
+            return false;
+        }
+    }
+    if (options.minReplicates < 1 || options.maxReplicates < options.minReplicates) {
+        std::cerr << "Bad choice for replicates.\n";
+        return false;
+    }
+    if (settings.leaseSeconds <= 0) {
+        std::cerr << "Bad choice for lease seconds.\n";
+        return false;
+    }
+    if (!(settings.metricsInterval > 0)) {
+        std::cerr << "Bad choice for metrics interval.\n";
+        return false;
+    }
+    if (settings.windowStep == 0) {
+        settings.windowStep = settings.windowTicks;
+    }
+    if (settings.windowTicks < 0 || settings.windowStep < 0 || settings.windowStep > settings.windowTicks) {
+        std::cerr << "Bad choice for windows, need 0 < step <= ticks.\n";
+        return false;
+    }
+    if (settings.heatmapCell < 0 || settings.heatmapTicks < 0) {
+        std::cerr << "Bad choice for heatmaps.\n";
+        return false;
+    }
+    if (settings.threads < 1) {
+        std::cerr << "Bad choice for threads.\n";
+        return false;
+    }
+    if (settings.reproProb < 0 || settings.predProb < 0) {
+        std::cerr << "Bad choice for probabilities.\n";
+        return false;
+    }
+    if ((!settings.populationFile.empty() || !settings.savePopulation.empty()) && settings.engine != Engine::Population) {
+        std::cerr << "Population snapshots are for the population engine.\n";
+        return false;
+    }
+    return true;
+}
+
+//First argument is number of snails, second is the length of the sim
+int main(int argc, char* argv[]) {
+    // <snails> can be left out when a snapshot supplies the population
+    int positionals = argc > 2 && std::string(argv[2]).compare(0, 2, "--") != 0 ? 2 : 1;
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " [<snails>] <simulationDuration> [--engine object|population|cohort]"
+                  << " [--min-replicates n] [--max-replicates n] [--ci-target fraction] [--repro-prob n] [--pred-prob n]"
+                  << " [--memory-report none|text|json] [--arrow none|results|all] [--matrix none|binary|csv]"
+                  << " [--trajectories none|all|sample] [--windows ticks] [--window-step ticks]"
+                  << " [--heatmap cells] [--heatmap-ticks ticks] [--threads n] [--seed n] [--config file] [--sweep file]"
+                  << " [--population snapshot] [--save-population snapshot]"
+                  << " [--metrics file | --metrics-socket path] [--metrics-interval s]"
+                  << " [--queue dir] [--lease-seconds s]\n";
+        return 1;
+    }
+
+    SweepSettings settings;
+    settings.configFile = "snailSim2.json";
+    settings.sweepFile = "snailSweep.json";
+    settings.snails = positionals == 2 ? std::stoi(argv[1]) : 0;
+    settings.duration = std::stoi(argv[positionals]);
+    settings.seed = static_cast<uint64_t>(time(0));
+#ifndef SNAILSIM_MPI
+    settings.threads = std::max(1u, std::thread::hardware_concurrency()); // MPI ranks already fill the cores
+#endif
+    if (!parseOptions(argc, argv, positionals + 1, settings)) {
+        return 1;
+    }
+    if (!settings.populationFile.empty()) {
+        try {
+            int rows = static_cast<int>(PopulationSnapshot(settings.populationFile).size());
+            if (positionals == 2 && settings.snails != rows) {
+                std::cerr << "Snapshot " << settings.populationFile << " holds " << rows << " snails, not " << settings.snails << ".\n";
+                return 1;
+            }
+            settings.snails = rows;
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    } else if (positionals == 1) {
+        std::cerr << "Number of snails is needed unless --population gives them.\n";
+        return 1;
+    }
+
+    // the object engine is only meant for small swamps; the population engine has no cap
+    int limit = settings.engine == Engine::Object ? 1000 : std::numeric_limits<int>::max();
+    if (settings.snails <= 0 || settings.snails >= limit) {
+        std::cerr << "Bad choice for number of snails.\n";
+        return 1;
+    }
+    if (settings.duration <= 0 || settings.duration >= limit) {
+        std::cerr << "Bad choice for duration.\n";
+        return 1;
+    }
+
+    // a bad config, sweep or region layout should stop us here, not halfway into the
+    // sweep, so every set of overrides the cells use is tried once
+    std::unique_ptr<SweepTable> table;
+    try {
+        table.reset(new SweepTable(compileSweep(settings)));
+        json config = readConfigJson(settings.configFile);
+        std::vector<ConfigOverrides> checked;
+        for (size_t i = 0; i < table->size(); i++) {
+            SweepCell cell = table->cell(i);
+            if (std::find(checked.begin(), checked.end(), cell.overrides) != checked.end()) continue;
+            SwampParams params = parseSwampParams(config, cell.overrides);
+            if (!settings.populationFile.empty()) {
+                PopulationSnapshot(settings.populationFile).check(params);
+            }
+            Swamp layoutCheck("Swamp", params.foodRegen, params.maxFood, params.initialFood, nullptr, params.width, params.length);
+            layoutCheck.setRegions(buildRegions(params));
+            checked.push_back(cell.overrides);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    // a burn-in: one run of the first cell, whose survivors later runs can start from
+    if (!settings.savePopulation.empty()) {
+#ifdef SNAILSIM_MPI
+        // one snapshot, so only rank 0 runs it; the others would all write the same file
+        MPI_Init(&argc, &argv);
+        int rank = 0;
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        if (rank != 0) {
+            MPI_Finalize();
+            return 0;
+        }
+#endif
+        globalRng.reseed(settings.seed);
+        RunRecorder recorder;
+        try {
+            runReplicate(settings, table->cell(0), recorder);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+#ifdef SNAILSIM_MPI
+            MPI_Abort(MPI_COMM_WORLD, 1);
+#endif
+            return 1;
+        }
+        std::cout << "Population after " << settings.duration << " ticks saved to " << settings.savePopulation << "\n";
+#ifdef SNAILSIM_MPI
+        MPI_Finalize();
+#endif
+        return 0;
+    }
+
+// Create objects and set dependencies
+    std::string outputDir = settings.queueDir.empty() ? "" : settings.queueDir + "/"; // the merged results stay with the queue
+    std::string csvPath = outputDir + "snail2_data.csv";
+    std::string posPath = outputDir + "snail2pos_data.csv";
+    SweepOutput output(csvPath, posPath, settings.memoryReport);
+    if (settings.arrow != ArrowOutput::None) {
+        output.enableArrow(outputDir + "snail2_data.arrow", settings.arrow == ArrowOutput::All ? outputDir + "snail2_series.arrow" : "");
+    }
+    if (settings.matrix != MatrixOutput::None) {
+        output.enableMatrix(settings.matrix, outputDir + (settings.matrix == MatrixOutput::Binary ? "snail2_matrix.bin" : "snail2_matrix"), *table);
+    }
+    if (settings.windowTicks > 0) {
+        output.enableWindows(outputDir + "snail2_windows.arrow", settings.windowTicks, settings.windowStep);
+    }
+    if (settings.heatmapCell > 0) {
+        output.enableHeatmaps(outputDir + "snail2_heatmaps.bin", settings.heatmapCell, settings.heatmapTicks);
+    }
+    if (settings.trajectories != TrajectoryMode::None) {
+        output.enableTrajectories(outputDir + "snail2_trajectories.bin");
+    }
+    bool wroteOutput = true;
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<MetricsPublisher> metrics; // publishes until main returns, the final figures included
+#ifdef SNAILSIM_MPI
+    MPI_Init(&argc, &argv);
+    int rank = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (!settings.metricsPath.empty()) { // one file or socket per rank, e.g. snail2.3.prom
+        std::string path = settings.metricsPath;
+        size_t dot = path.find_last_of('.');
+        size_t slash = path.find_last_of('/');
+        std::string tag = "." + std::to_string(rank);
+        path = dot != std::string::npos && (slash == std::string::npos || dot > slash) ? path.insert(dot, tag) : path + tag;
+        try {
+            metrics.reset(new MetricsPublisher(liveMetrics, path, settings.metricsSocket, workerName() + "-rank" + std::to_string(rank), settings.metricsInterval));
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    globalRng.reseed(settings.seed + 7919 * static_cast<uint64_t>(rank)); // every rank needs its own stream
+    if (output.getRuns()) { // each rank writes its own runs
+        output.getRuns()->setPaths("snail2_series." + std::to_string(rank) + ".arrow", "snail2_windows." + std::to_string(rank) + ".arrow",
+                                   "snail2_heatmaps." + std::to_string(rank) + ".bin",
+                                   "snail2_trajectories." + std::to_string(rank) + ".bin");
+    }
+    runSweepMPI(*table, settings, output);
+    MPI_Finalize();
+    if (rank != 0) {
+        return 0;
+    }
+#else
+    if (!settings.metricsPath.empty()) {
+        try {
+            metrics.reset(new MetricsPublisher(liveMetrics, settings.metricsPath, settings.metricsSocket, workerName(), settings.metricsInterval));
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+    globalRng.reseed(settings.seed);
+    if (settings.queueDir.empty()) {
+        runSweep(*table, settings, output);
+    } else {
+        try {
+            wroteOutput = runSweepQueue(*table, settings, output);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+#endif
+    const Throughput& throughput = output.throughput;
+    output.finish();
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Throughput: " << throughput.rate() << " snail-ticks/s per worker, "
+              << (wallSeconds > 0.0 ? throughput.snailTicks / wallSeconds : 0.0) << " snail-ticks/s overall ("
+              << throughput.snailTicks << " snail-ticks in " << wallSeconds << " s)\n";
+    if (!wroteOutput) {
+        std::cout << "No Errors ;). Cells are in the queue's shards, another worker merges them\n";
+        return 0;
+    }
+    std::cout << "No Errors ;). Output is at " << csvPath << " and " << posPath << "\n";
+    return 0;
+}